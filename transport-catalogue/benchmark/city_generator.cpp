@@ -0,0 +1,438 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "geo.h"
+#include "json.h"
+#include "json_builder.h"
+
+using namespace std::literals;
+
+// Synthetic city generator: writes a make_base input and a process_requests input
+// for a random network with the requested size and request mix.
+
+struct GeneratorSettings {
+    int stops = 1000;
+    int routes = 100;
+
+    int min_route_length = 5;
+    int max_route_length = 30;
+    // "uniform" or "normal" (mean in the middle of the range, clamped to it)
+    std::string route_length_distribution = "uniform"s;
+    double roundtrip_share = 0.5;
+
+    // Average number of road_distances per stop besides the ones routes need
+    double distance_density = 1.0;
+
+    int requests = 1000;
+    // Weights of Stop, Bus, Route and Map requests
+    std::vector<double> request_mix = {40, 40, 19, 1};
+
+    uint32_t seed = 42;
+    std::string file = "transport_catalogue.db"s;
+
+    std::string base_out;
+    std::string requests_out;
+};
+
+void PrintUsage(std::ostream& stream = std::cerr) {
+    stream << "Usage: city_generator --base-out FILE --requests-out FILE [options]\n"sv
+           << "  --stops N                      number of stops (1000)\n"sv
+           << "  --routes N                     number of buses (100)\n"sv
+           << "  --min-route-length N           stops in the shortest bus (5)\n"sv
+           << "  --max-route-length N           stops in the longest bus (30)\n"sv
+           << "  --route-length-distribution D  uniform | normal (uniform)\n"sv
+           << "  --roundtrip-share F            share of round trip buses (0.5)\n"sv
+           << "  --distance-density F           extra road_distances per stop (1.0)\n"sv
+           << "  --requests N                   number of stat_requests (1000)\n"sv
+           << "  --mix S:B:R:M                  weights of Stop, Bus, Route, Map requests (40:40:19:1)\n"sv
+           << "  --seed N                       random seed (42)\n"sv
+           << "  --file FILE                    serialization_settings file (transport_catalogue.db)\n"sv;
+}
+
+bool ParseArguments(int argc, char* argv[], GeneratorSettings& settings) {
+
+    for (int index = 1; index < argc; ++index) {
+
+        const std::string_view option(argv[index]);
+        if (index + 1 == argc) {
+            std::cerr << "Missing value for "sv << option << std::endl;
+            return false;
+        }
+        const std::string value(argv[++index]);
+
+        if (option == "--stops"sv) {
+            settings.stops = std::stoi(value);
+        } else if (option == "--routes"sv) {
+            settings.routes = std::stoi(value);
+        } else if (option == "--min-route-length"sv) {
+            settings.min_route_length = std::stoi(value);
+        } else if (option == "--max-route-length"sv) {
+            settings.max_route_length = std::stoi(value);
+        } else if (option == "--route-length-distribution"sv) {
+            settings.route_length_distribution = value;
+        } else if (option == "--roundtrip-share"sv) {
+            settings.roundtrip_share = std::stod(value);
+        } else if (option == "--distance-density"sv) {
+            settings.distance_density = std::stod(value);
+        } else if (option == "--requests"sv) {
+            settings.requests = std::stoi(value);
+        } else if (option == "--mix"sv) {
+            settings.request_mix.clear();
+            size_t begin = 0;
+            while (begin <= value.size()) {
+                size_t end = std::min(value.find(':', begin), value.size());
+                settings.request_mix.push_back(std::stod(value.substr(begin, end - begin)));
+                begin = end + 1;
+            }
+        } else if (option == "--seed"sv) {
+            settings.seed = static_cast<uint32_t>(std::stoul(value));
+        } else if (option == "--file"sv) {
+            settings.file = value;
+        } else if (option == "--base-out"sv) {
+            settings.base_out = value;
+        } else if (option == "--requests-out"sv) {
+            settings.requests_out = value;
+        } else {
+            std::cerr << "Unknown option "sv << option << std::endl;
+            return false;
+        }
+    }
+
+    if (settings.base_out.empty() || settings.requests_out.empty() || settings.request_mix.size() != 4
+        || settings.stops < 2 || settings.min_route_length < 2
+        || settings.min_route_length > settings.max_route_length) {
+        return false;
+    }
+    return true;
+}
+
+class CityGenerator {
+public:
+    explicit CityGenerator(const GeneratorSettings& settings)
+        : settings_(settings), random_(settings.seed)
+    {
+        PlaceStops();
+        BuildRoutes();
+        AddExtraDistances();
+    }
+
+    json::Node MakeBaseInput() const;
+
+    json::Node MakeRequestsInput();
+
+private:
+    struct Bus {
+        std::string name;
+        std::vector<int> stops;
+        bool is_roundtrip;
+    };
+
+    const GeneratorSettings& settings_;
+    std::mt19937 random_;
+
+    std::vector<std::string> stop_names_;
+    std::vector<geo::Coordinates> coordinates_;
+    std::vector<Bus> buses_;
+    std::map<std::pair<int, int>, int> distances_;
+
+    // Stops are bucketed into a grid to pick route neighbours without a full scan
+    double cell_size_ = 0;
+    std::unordered_map<int64_t, std::vector<int>> grid_;
+
+    static constexpr double MIN_LAT = 55.55;
+    static constexpr double MAX_LAT = 55.90;
+    static constexpr double MIN_LNG = 37.35;
+    static constexpr double MAX_LNG = 37.85;
+
+    int64_t CellKey(int64_t x, int64_t y) const {
+        return x * 1000003 + y;
+    }
+
+    std::pair<int64_t, int64_t> CellOf(geo::Coordinates point) const {
+        return {static_cast<int64_t>((point.lng - MIN_LNG) / cell_size_),
+                static_cast<int64_t>((point.lat - MIN_LAT) / cell_size_)};
+    }
+
+    void PlaceStops();
+    void BuildRoutes();
+    void AddExtraDistances();
+
+    std::vector<int> NearestStops(int stop, size_t count) const;
+    int RouteLength();
+    void AddDistance(int from, int to);
+};
+
+void CityGenerator::PlaceStops() {
+
+    std::uniform_real_distribution<double> lat(MIN_LAT, MAX_LAT);
+    std::uniform_real_distribution<double> lng(MIN_LNG, MAX_LNG);
+
+    // About four stops per grid cell
+    cell_size_ = std::sqrt((MAX_LAT - MIN_LAT) * (MAX_LNG - MIN_LNG) * 4 / settings_.stops);
+
+    for (int index = 0; index < settings_.stops; ++index) {
+        stop_names_.push_back("Stop "s + std::to_string(index));
+        coordinates_.push_back({lat(random_), lng(random_)});
+        auto [x, y] = CellOf(coordinates_.back());
+        grid_[CellKey(x, y)].push_back(index);
+    }
+}
+
+std::vector<int> CityGenerator::NearestStops(int stop, size_t count) const {
+
+    auto [cell_x, cell_y] = CellOf(coordinates_[stop]);
+    std::vector<int> candidates;
+
+    // Grow the searched square until it holds enough stops
+    for (int64_t radius = 1; candidates.size() <= count && radius < 1000; ++radius) {
+        candidates.clear();
+        for (int64_t x = cell_x - radius; x <= cell_x + radius; ++x) {
+            for (int64_t y = cell_y - radius; y <= cell_y + radius; ++y) {
+                auto it = grid_.find(CellKey(x, y));
+                if (it == grid_.end()) {
+                    continue;
+                }
+                for (int other : it->second) {
+                    if (other != stop) {
+                        candidates.push_back(other);
+                    }
+                }
+            }
+        }
+    }
+
+    const auto origin = coordinates_[stop];
+    std::sort(candidates.begin(), candidates.end(), [&](int lhs, int rhs) {
+        return geo::ComputeDistance(origin, coordinates_[lhs]) < geo::ComputeDistance(origin, coordinates_[rhs]);
+    });
+    if (candidates.size() > count) {
+        candidates.resize(count);
+    }
+    return candidates;
+}
+
+int CityGenerator::RouteLength() {
+
+    if (settings_.route_length_distribution == "normal"s) {
+        const double mean = (settings_.min_route_length + settings_.max_route_length) / 2.0;
+        const double deviation = std::max(1.0, (settings_.max_route_length - settings_.min_route_length) / 6.0);
+        std::normal_distribution<double> length(mean, deviation);
+        return std::clamp(static_cast<int>(std::lround(length(random_))),
+                          settings_.min_route_length, settings_.max_route_length);
+    }
+
+    std::uniform_int_distribution<int> length(settings_.min_route_length, settings_.max_route_length);
+    return length(random_);
+}
+
+void CityGenerator::AddDistance(int from, int to) {
+    if (from == to || distances_.count({from, to}) != 0) {
+        return;
+    }
+    // Roads are 10-40% longer than the straight line
+    std::uniform_real_distribution<double> detour(1.1, 1.4);
+    const double straight = geo::ComputeDistance(coordinates_[from], coordinates_[to]);
+    distances_[{from, to}] = std::max(1, static_cast<int>(std::ceil(straight * detour(random_))));
+}
+
+void CityGenerator::BuildRoutes() {
+
+    std::uniform_int_distribution<int> any_stop(0, settings_.stops - 1);
+    std::bernoulli_distribution is_roundtrip(settings_.roundtrip_share);
+
+    for (int index = 0; index < settings_.routes; ++index) {
+
+        Bus bus{"Bus "s + std::to_string(index), {}, is_roundtrip(random_)};
+        const int length = RouteLength();
+
+        // Random walk over near neighbours, a stop is not visited twice
+        std::vector<bool> visited(settings_.stops, false);
+        int current = any_stop(random_);
+        bus.stops.push_back(current);
+        visited[current] = true;
+
+        while (static_cast<int>(bus.stops.size()) < (bus.is_roundtrip ? length - 1 : length)) {
+            std::vector<int> next;
+            for (int candidate : NearestStops(current, 8)) {
+                if (!visited[candidate]) {
+                    next.push_back(candidate);
+                }
+            }
+            if (next.empty()) {
+                break;
+            }
+            current = next[std::uniform_int_distribution<size_t>(0, next.size() - 1)(random_)];
+            bus.stops.push_back(current);
+            visited[current] = true;
+        }
+
+        if (bus.is_roundtrip) {
+            bus.stops.push_back(bus.stops.front());
+        }
+
+        for (size_t stop = 0; stop + 1 < bus.stops.size(); ++stop) {
+            AddDistance(bus.stops[stop], bus.stops[stop + 1]);
+        }
+
+        buses_.push_back(std::move(bus));
+    }
+}
+
+void CityGenerator::AddExtraDistances() {
+
+    std::poisson_distribution<int> extra(settings_.distance_density);
+
+    for (int stop = 0; stop < settings_.stops; ++stop) {
+        const int count = extra(random_);
+        if (count == 0) {
+            continue;
+        }
+        for (int neighbour : NearestStops(stop, static_cast<size_t>(count))) {
+            AddDistance(stop, neighbour);
+        }
+    }
+}
+
+json::Node CityGenerator::MakeBaseInput() const {
+
+    using namespace json;
+
+    std::vector<Dict> road_distances(settings_.stops);
+    for (const auto& [stops, distance] : distances_) {
+        road_distances[stops.first][stop_names_[stops.second]] = distance;
+    }
+
+    Array base_requests;
+
+    for (int stop = 0; stop < settings_.stops; ++stop) {
+        base_requests.emplace_back(Builder{}.StartDict()
+                .Key("type"s).Value("Stop"s)
+                .Key("name"s).Value(stop_names_[stop])
+                .Key("latitude"s).Value(coordinates_[stop].lat)
+                .Key("longitude"s).Value(coordinates_[stop].lng)
+                .Key("road_distances"s).Value(road_distances[stop])
+                .EndDict().Build());
+    }
+
+    for (const auto& bus : buses_) {
+        Array stops;
+        for (int stop : bus.stops) {
+            stops.emplace_back(stop_names_[stop]);
+        }
+        base_requests.emplace_back(Builder{}.StartDict()
+                .Key("type"s).Value("Bus"s)
+                .Key("name"s).Value(bus.name)
+                .Key("stops"s).Value(stops)
+                .Key("is_roundtrip"s).Value(bus.is_roundtrip)
+                .EndDict().Build());
+    }
+
+    Array palette{Node("green"s), Node(Array{Node(255), Node(160), Node(0)}), Node("red"s),
+                  Node("blue"s), Node(Array{Node(128), Node(0), Node(128), Node(0.8)})};
+
+    return Builder{}.StartDict()
+            .Key("serialization_settings"s).StartDict().Key("file"s).Value(settings_.file).EndDict()
+            .Key("routing_settings"s).StartDict()
+                .Key("bus_wait_time"s).Value(6)
+                .Key("bus_velocity"s).Value(40)
+            .EndDict()
+            .Key("render_settings"s).StartDict()
+                .Key("width"s).Value(1200.0)
+                .Key("height"s).Value(1200.0)
+                .Key("padding"s).Value(50.0)
+                .Key("stop_radius"s).Value(5.0)
+                .Key("line_width"s).Value(14.0)
+                .Key("bus_label_font_size"s).Value(20)
+                .Key("bus_label_offset"s).Value(Array{Node(7.0), Node(15.0)})
+                .Key("stop_label_font_size"s).Value(20)
+                .Key("stop_label_offset"s).Value(Array{Node(7.0), Node(-3.0)})
+                .Key("underlayer_color"s).Value(Array{Node(255), Node(255), Node(255), Node(0.85)})
+                .Key("underlayer_width"s).Value(3.0)
+                .Key("color_palette"s).Value(palette)
+            .EndDict()
+            .Key("base_requests"s).Value(base_requests)
+            .EndDict().Build();
+}
+
+json::Node CityGenerator::MakeRequestsInput() {
+
+    using namespace json;
+
+    std::discrete_distribution<int> request_type(settings_.request_mix.begin(), settings_.request_mix.end());
+    std::uniform_int_distribution<int> any_stop(0, settings_.stops - 1);
+    std::uniform_int_distribution<int> any_bus(0, std::max(0, settings_.routes - 1));
+    std::bernoulli_distribution is_missing(0.05);
+
+    Array stat_requests;
+
+    for (int id = 1; id <= settings_.requests; ++id) {
+
+        Builder request;
+        auto dict = request.StartDict().Key("id"s).Value(id);
+
+        switch (request_type(random_)) {
+            case 0 :
+                dict.Key("type"s).Value("Stop"s)
+                    .Key("name"s).Value(is_missing(random_) ? "Missing stop"s : stop_names_[any_stop(random_)]);
+                break;
+            case 1 :
+                dict.Key("type"s).Value("Bus"s)
+                    .Key("name"s).Value(is_missing(random_) || buses_.empty() ? "Missing bus"s
+                                                                               : buses_[any_bus(random_)].name);
+                break;
+            case 2 :
+                dict.Key("type"s).Value("Route"s)
+                    .Key("from"s).Value(stop_names_[any_stop(random_)])
+                    .Key("to"s).Value(stop_names_[any_stop(random_)]);
+                break;
+            default :
+                dict.Key("type"s).Value("Map"s);
+                break;
+        }
+
+        stat_requests.emplace_back(dict.EndDict().Build());
+    }
+
+    return Builder{}.StartDict()
+            .Key("serialization_settings"s).StartDict().Key("file"s).Value(settings_.file).EndDict()
+            .Key("stat_requests"s).Value(stat_requests)
+            .EndDict().Build();
+}
+
+int main(int argc, char* argv[]) {
+
+    GeneratorSettings settings;
+
+    try {
+        if (!ParseArguments(argc, argv, settings)) {
+            PrintUsage();
+            return 1;
+        }
+    } catch (const std::exception& error) {
+        std::cerr << "Invalid argument: "sv << error.what() << std::endl;
+        PrintUsage();
+        return 1;
+    }
+
+    CityGenerator generator(settings);
+
+    std::ofstream base_out(settings.base_out);
+    std::ofstream requests_out(settings.requests_out);
+    if (!base_out || !requests_out) {
+        std::cerr << "Unable to open output files"sv << std::endl;
+        return 1;
+    }
+
+    json::Print(json::Document(generator.MakeBaseInput()), base_out);
+    json::Print(json::Document(generator.MakeRequestsInput()), requests_out);
+
+    return 0;
+}
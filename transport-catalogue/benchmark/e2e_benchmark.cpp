@@ -0,0 +1,239 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "json.h"
+#include "json_builder.h"
+#include "json_reader.h"
+#include "profile.h"
+#include "serialization.h"
+#include "transport_catalogue.h"
+
+using namespace std::literals;
+
+// End-to-end harness: runs the make_base and process_requests pipelines in-process
+// on the given inputs and reports wall time, peak RSS and the time of every phase.
+// The base is built twice, sequentially and with concurrent stages, to report the speedup.
+
+class PhaseReport {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    template <typename Func>
+    auto Measure(const std::string& phase, Func&& func) {
+        const auto start = Clock::now();
+        if constexpr (std::is_void_v<decltype(func())>) {
+            func();
+            Add(phase, Clock::now() - start);
+        } else {
+            auto result = func();
+            Add(phase, Clock::now() - start);
+            return result;
+        }
+    }
+
+    void Add(const std::string& phase, Clock::duration duration) {
+        AddMs(phase, std::chrono::duration<double, std::milli>(duration).count());
+    }
+
+    void AddMs(const std::string& phase, double ms) {
+        if (phases_.count(phase) == 0) {
+            order_.push_back(phase);
+        }
+        auto& stat = phases_[phase];
+        stat.total_ms += ms;
+        stat.max_ms = std::max(stat.max_ms, ms);
+        ++stat.count;
+    }
+
+    // Ratio of the total times of the phases, 0 if one of them was not measured
+    double GetSpeedup(const std::string& baseline, const std::string& phase) const {
+        if (phases_.count(baseline) == 0 || phases_.count(phase) == 0 || phases_.at(phase).total_ms == 0) {
+            return 0.0;
+        }
+        return phases_.at(baseline).total_ms / phases_.at(phase).total_ms;
+    }
+
+    json::Array ToJson() const {
+        json::Array result;
+        for (const auto& phase : order_) {
+            const auto& stat = phases_.at(phase);
+            result.emplace_back(json::Builder{}.StartDict()
+                    .Key("phase"s).Value(phase)
+                    .Key("count"s).Value(stat.count)
+                    .Key("total_ms"s).Value(stat.total_ms)
+                    .Key("mean_ms"s).Value(stat.total_ms / stat.count)
+                    .Key("max_ms"s).Value(stat.max_ms)
+                    .EndDict().Build());
+        }
+        return result;
+    }
+
+private:
+    struct Stat {
+        int count = 0;
+        double total_ms = 0;
+        double max_ms = 0;
+    };
+
+    std::vector<std::string> order_;
+    std::map<std::string, Stat> phases_;
+};
+
+std::string ReadFile(const std::string& path) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        throw std::runtime_error("Unable to open "s + path);
+    }
+    std::ostringstream content;
+    content << input.rdbuf();
+    return content.str();
+}
+
+long PeakRssKb() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// The phases are reported as <prefix>.<phase>, the base build runs its stages concurrently if parallel is set
+void RunMakeBase(const std::string& input_text, PhaseReport& report, const std::string& prefix, bool parallel) {
+
+    transport_catalogue::TransportCatalogue catalogue;
+    JsonReader reader(&catalogue);
+
+    report.Measure(prefix + ".parse"s, [&] {
+        std::istringstream input(input_text);
+        reader.ReadJSON(input);
+    });
+
+    report.Measure(prefix + ".fill_catalogue"s, [&] { reader.FillCatalogue(); });
+
+    const auto& root = reader.GetJSONDocument().GetRoot().AsDict();
+    const auto routing_settings = serial_database::RouterSettingsFromJSON(root.at("routing_settings"s).AsDict());
+
+    // The stages of BuildBase are taken from its profile timers, select_landmarks is a part of serialize_router.
+    // With parallel set the stages overlap, so their sum may exceed the time of the whole build
+    static const std::vector<std::pair<std::string_view, std::string>> BUILD_STAGES = {
+            {"make_base.router_build"sv, ".router_build"s},
+            {"router.select_landmarks"sv, ".select_landmarks"s},
+            {"make_base.serialize_router"sv, ".serialize_router"s},
+            {"make_base.serialize_catalogue"sv, ".serialize_catalogue"s},
+            {"make_base.serialize_render_settings"sv, ".serialize_render_settings"s},
+    };
+    std::vector<double> stage_starts;
+    for (const auto& [timer, phase] : BUILD_STAGES) {
+        stage_starts.push_back(profile::GetTotalTime(timer));
+    }
+
+    profile::Enable({});
+    auto data = report.Measure(prefix + ".build"s, [&] {
+        return serial_database::BuildBase(catalogue, routing_settings, root.at("render_settings"s).AsDict(), parallel);
+    });
+    profile::Disable();
+
+    for (size_t index = 0; index < BUILD_STAGES.size(); ++index) {
+        report.AddMs(prefix + BUILD_STAGES[index].second,
+                     profile::GetTotalTime(BUILD_STAGES[index].first) - stage_starts[index]);
+    }
+
+    report.Measure(prefix + ".write"s, [&] {
+        std::ofstream out_file(root.at("serialization_settings"s).AsDict().at("file"s).AsString(), std::ios::binary);
+        data.SerializePartialToOstream(&out_file);
+    });
+}
+
+void RunProcessRequests(const std::string& input_text, PhaseReport& report) {
+
+    transport_catalogue::TransportCatalogue catalogue;
+    JsonReader reader(&catalogue);
+
+    report.Measure("process_requests.parse"s, [&] {
+        std::istringstream input(input_text);
+        reader.ReadJSON(input);
+    });
+
+    const auto& root = reader.GetJSONDocument().GetRoot().AsDict();
+
+    auto proto_catalogue = report.Measure("process_requests.read_base"s, [&] {
+        std::ifstream in_file(root.at("serialization_settings"s).AsDict().at("file"s).AsString(), std::ios::binary);
+        return serial_database::DeserializeFile(in_file);
+    });
+
+    report.Measure("process_requests.fill_catalogue"s, [&] {
+        serial_database::FillCatalogue(proto_catalogue, catalogue);
+    });
+
+    report.Measure("process_requests.render_settings"s, [&] {
+        reader.SetRenderSettings(serial_database::DeserializeRenderSettings(proto_catalogue));
+    });
+
+    report.Measure("process_requests.deserialize_router"s, [&] {
+        serial_database::DeserializeRouter(catalogue, proto_catalogue.router());
+    });
+
+    // The first path request pays for the lazy router initialization, it is reported apart
+    bool is_first_path_request = true;
+
+    for (const auto& request : root.at("stat_requests"s).AsArray()) {
+        const auto& dict = request.AsDict();
+        std::string phase = "request."s + dict.at("type"s).AsString();
+        if (dict.at("type"s).AsString() == "Route"s && is_first_path_request) {
+            phase = "request.Route.first"s;
+            is_first_path_request = false;
+        }
+        report.Measure(phase, [&] { reader.ProcessRequest(dict); });
+    }
+
+    report.Measure("process_requests.print"s, [&] {
+        std::ostringstream output;
+        reader.PrintResponses(output);
+    });
+}
+
+int main(int argc, char* argv[]) {
+
+    if (argc != 3) {
+        std::cerr << "Usage: e2e_benchmark <make_base input.json> <process_requests input.json>\n"sv;
+        return 1;
+    }
+
+    PhaseReport report;
+    const auto start = PhaseReport::Clock::now();
+
+    try {
+        const auto base_text = report.Measure("make_base.read_input"s, [&] { return ReadFile(argv[1]); });
+        // The sequential build goes first so that the parallel one is compared on the same input
+        RunMakeBase(base_text, report, "make_base.sequential"s, false);
+        RunMakeBase(base_text, report, "make_base"s, true);
+
+        const auto requests_text = report.Measure("process_requests.read_input"s, [&] { return ReadFile(argv[2]); });
+        RunProcessRequests(requests_text, report);
+    } catch (const std::exception& error) {
+        std::cerr << "Benchmark failed: "sv << error.what() << std::endl;
+        return 1;
+    }
+
+    const double wall_ms = std::chrono::duration<double, std::milli>(PhaseReport::Clock::now() - start).count();
+
+    json::Print(json::Document(json::Builder{}.StartDict()
+                                       .Key("base_input"s).Value(std::string(argv[1]))
+                                       .Key("requests_input"s).Value(std::string(argv[2]))
+                                       .Key("wall_ms"s).Value(wall_ms)
+                                       .Key("peak_rss_kb"s).Value(static_cast<int>(PeakRssKb()))
+                                       .Key("make_base_build_speedup"s).Value(report.GetSpeedup(
+                                               "make_base.sequential.build"s, "make_base.build"s))
+                                       .Key("phases"s).Value(report.ToJson())
+                                       .EndDict().Build()),
+                std::cout);
+    std::cout << std::endl;
+
+    return 0;
+}
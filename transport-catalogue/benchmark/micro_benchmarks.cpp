@@ -0,0 +1,286 @@
+#include <cmath>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "microbench.h"
+
+#include "geo.h"
+#include "graph.h"
+#include "json.h"
+#include "json_builder.h"
+#include "router.h"
+#include "svg.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+using namespace std::literals;
+
+// Microbenchmarks for the core data structures and kernels. The argument of every
+// benchmark is the input size (stops, nodes, objects), results can be stored with
+// --json and compared against them later with --baseline.
+
+// ------------------ Inputs ------------------
+
+static std::string StopName(int64_t index) {
+    return "Stop "s + std::to_string(index);
+}
+
+// Stops on a square grid, every bus walks 16 stops to the right or down from a random stop
+static std::unique_ptr<transport_catalogue::TransportCatalogue> MakeCatalogue(int64_t stop_count) {
+
+    auto catalogue = std::make_unique<transport_catalogue::TransportCatalogue>();
+    const int64_t side = std::max<int64_t>(2, static_cast<int64_t>(std::ceil(std::sqrt(stop_count))));
+
+    for (int64_t index = 0; index < side * side; ++index) {
+        catalogue->AddStop(StopName(index), {55.5 + 0.005 * (index / side), 37.5 + 0.005 * (index % side)});
+    }
+
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int64_t> any_stop(0, side * side - 1);
+    std::bernoulli_distribution go_right(0.5);
+
+    const int64_t route_count = std::max<int64_t>(1, stop_count / 8);
+    for (int64_t route = 0; route < route_count; ++route) {
+        int64_t current = any_stop(random);
+        std::vector<std::string> stops{StopName(current)};
+        for (int step = 0; step < 15; ++step) {
+            int64_t next = current;
+            if (go_right(random) && current % side + 1 < side) {
+                next = current + 1;
+            } else if (current / side + 1 < side) {
+                next = current + side;
+            } else if (current % side + 1 < side) {
+                next = current + 1;
+            } else {
+                break;
+            }
+            catalogue->SetDistance(StopName(current), StopName(next), 500 + static_cast<int>(next % 300));
+            stops.push_back(StopName(next));
+            current = next;
+        }
+        catalogue->AddRoute("Bus "s + std::to_string(route), stops, true);
+    }
+
+    return catalogue;
+}
+
+static json::Node MakeJson(int64_t size) {
+    json::Array stops;
+    for (int64_t index = 0; index < size; ++index) {
+        stops.emplace_back(json::Builder{}.StartDict()
+                .Key("type"s).Value("Stop"s)
+                .Key("name"s).Value(StopName(index))
+                .Key("latitude"s).Value(55.5 + index * 1e-4)
+                .Key("longitude"s).Value(37.5 - index * 1e-4)
+                .Key("road_distances"s).StartDict().Key(StopName(index + 1)).Value(1000).EndDict()
+                .EndDict().Build());
+    }
+    return json::Node(std::move(stops));
+}
+
+static graph::DirectedWeightedGraph<double> MakeGraph(int64_t vertex_count) {
+    graph::DirectedWeightedGraph<double> graph(vertex_count);
+    std::mt19937 random(7);
+    std::uniform_int_distribution<int64_t> any_vertex(0, vertex_count - 1);
+    std::uniform_real_distribution<double> weight(1.0, 10.0);
+    for (int64_t edge = 0; edge < vertex_count * 4; ++edge) {
+        graph.AddEdge({static_cast<graph::VertexId>(any_vertex(random)),
+                       static_cast<graph::VertexId>(any_vertex(random)), weight(random)});
+    }
+    return graph;
+}
+
+// ------------------ geo ------------------
+
+void BM_GeoComputeDistance(microbench::State& state) {
+    std::mt19937 random(1);
+    std::uniform_real_distribution<double> lat(55.0, 56.0);
+    std::uniform_real_distribution<double> lng(37.0, 38.0);
+    std::vector<geo::Coordinates> points(1024);
+    for (auto& point : points) {
+        point = {lat(random), lng(random)};
+    }
+
+    size_t index = 0;
+    while (state.KeepRunning()) {
+        microbench::DoNotOptimize(geo::ComputeDistance(points[index & 1023], points[(index + 1) & 1023]));
+        ++index;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+MICROBENCH(BM_GeoComputeDistance);
+
+// ------------------ json ------------------
+
+void BM_JsonLoad(microbench::State& state) {
+    std::ostringstream text;
+    json::Print(json::Document(MakeJson(state.range())), text);
+    const std::string input = text.str();
+
+    while (state.KeepRunning()) {
+        std::istringstream stream(input);
+        auto document = json::Load(stream);
+        microbench::DoNotOptimize(document);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range());
+}
+MICROBENCH(BM_JsonLoad)->Range(16, 4096);
+
+void BM_JsonPrint(microbench::State& state) {
+    const json::Document document(MakeJson(state.range()));
+
+    while (state.KeepRunning()) {
+        std::ostringstream stream;
+        json::Print(document, stream);
+        microbench::DoNotOptimize(stream);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range());
+}
+MICROBENCH(BM_JsonPrint)->Range(16, 4096);
+
+void BM_JsonBuilder(microbench::State& state) {
+    while (state.KeepRunning()) {
+        auto node = MakeJson(state.range());
+        microbench::DoNotOptimize(node);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range());
+}
+MICROBENCH(BM_JsonBuilder)->Range(16, 4096);
+
+// ------------------ TransportCatalogue ------------------
+
+void BM_CatalogueSearchStop(microbench::State& state) {
+    auto catalogue = MakeCatalogue(state.range());
+    std::vector<std::string> names;
+    for (int64_t index = 0; index < 1024; ++index) {
+        names.push_back(StopName(index * 7919 % state.range()));
+    }
+
+    size_t index = 0;
+    while (state.KeepRunning()) {
+        auto response = catalogue->SearchStop(names[index++ & 1023]);
+        microbench::DoNotOptimize(response);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+MICROBENCH(BM_CatalogueSearchStop)->Range(64, 16384);
+
+// Route stats are cached after the first request, this measures the steady state
+void BM_CatalogueSearchRoute(microbench::State& state) {
+    auto catalogue = MakeCatalogue(state.range());
+    const int64_t route_count = static_cast<int64_t>(catalogue->GetConstRoutePtr()->size());
+    std::vector<std::string> names;
+    for (int64_t index = 0; index < 1024; ++index) {
+        names.push_back("Bus "s + std::to_string(index * 7919 % route_count));
+    }
+
+    size_t index = 0;
+    while (state.KeepRunning()) {
+        auto response = catalogue->SearchRoute(names[index++ & 1023]);
+        microbench::DoNotOptimize(response);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+MICROBENCH(BM_CatalogueSearchRoute)->Range(64, 16384);
+
+void BM_CatalogueGetDistance(microbench::State& state) {
+    auto catalogue = MakeCatalogue(state.range());
+    std::vector<std::pair<std::string, std::string>> pairs;
+    for (const auto& route : *catalogue->GetConstRoutePtr()) {
+        for (size_t stop = 0; stop + 1 < route.stops.size() && pairs.size() < 1024; ++stop) {
+            pairs.emplace_back(route.stops[stop]->name, route.stops[stop + 1]->name);
+        }
+    }
+
+    size_t index = 0;
+    while (state.KeepRunning()) {
+        const auto& [from, to] = pairs[index++ % pairs.size()];
+        microbench::DoNotOptimize(catalogue->GetDistance(from, to));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+MICROBENCH(BM_CatalogueGetDistance)->Range(64, 16384);
+
+// ------------------ Routing ------------------
+
+// TransportRouter constructor runs AutoFillGraph
+void BM_TransportRouterAutoFillGraph(microbench::State& state) {
+    auto catalogue = MakeCatalogue(state.range());
+
+    // Fills the accumulated distances of the routes the router reads
+    for (const auto& route : *catalogue->GetConstRoutePtr()) {
+        catalogue->CalculateTrueRouteLength(route.name);
+    }
+
+    while (state.KeepRunning()) {
+        transport_catalogue::TransportRouter router(transport_catalogue::RouterSettings{6.0, 40.0},
+                                                    *catalogue->GetConstRoutePtr(),
+                                                    catalogue->GetConstStopsPtr()->size());
+        microbench::DoNotOptimize(router);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(catalogue->GetConstRoutePtr()->size()));
+}
+MICROBENCH(BM_TransportRouterAutoFillGraph)->Range(64, 4096);
+
+void BM_GraphRouterBuild(microbench::State& state) {
+    const auto graph = MakeGraph(state.range());
+
+    while (state.KeepRunning()) {
+        graph::Router<double> router(graph);
+        microbench::DoNotOptimize(router);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range());
+}
+MICROBENCH(BM_GraphRouterBuild)->Range(16, 512, 2);
+
+void BM_GraphRouterBuildRoute(microbench::State& state) {
+    const auto graph = MakeGraph(state.range());
+    const graph::Router<double> router(graph);
+
+    std::mt19937 random(3);
+    std::uniform_int_distribution<int64_t> any_vertex(0, state.range() - 1);
+    std::vector<std::pair<graph::VertexId, graph::VertexId>> queries(1024);
+    for (auto& query : queries) {
+        query = {static_cast<graph::VertexId>(any_vertex(random)), static_cast<graph::VertexId>(any_vertex(random))};
+    }
+
+    size_t index = 0;
+    while (state.KeepRunning()) {
+        const auto& [from, to] = queries[index++ & 1023];
+        auto route = router.BuildRoute(from, to);
+        microbench::DoNotOptimize(route);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+MICROBENCH(BM_GraphRouterBuildRoute)->Range(16, 512, 2);
+
+// ------------------ svg ------------------
+
+void BM_SvgDocumentRender(microbench::State& state) {
+    svg::Document document;
+    for (int64_t index = 0; index < state.range(); ++index) {
+        svg::Polyline line;
+        for (int point = 0; point < 8; ++point) {
+            line.AddPoint({index * 1.5 + point, point * 2.25});
+        }
+        document.Add(line.SetStrokeColor("green"s).SetStrokeWidth(14).SetFillColor(svg::NoneColor));
+        document.Add(svg::Circle().SetCenter({index * 1.5, 3.75}).SetRadius(5).SetFillColor("white"s));
+        document.Add(svg::Text().SetPosition({index * 1.5, 3.75}).SetOffset({7, -3}).SetFontSize(20)
+                             .SetFontFamily("Verdana"s).SetData(StopName(index)).SetFillColor("black"s));
+    }
+
+    while (state.KeepRunning()) {
+        std::ostringstream output;
+        document.Render(output);
+        microbench::DoNotOptimize(output);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range() * 3);
+}
+MICROBENCH(BM_SvgDocumentRender)->Range(16, 4096);
+
+int main(int argc, char* argv[]) {
+    return microbench::RunAll(argc, argv);
+}
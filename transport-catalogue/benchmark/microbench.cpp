@@ -0,0 +1,201 @@
+#include "microbench.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string_view>
+
+#include "json.h"
+#include "json_builder.h"
+
+using namespace std::literals;
+
+namespace microbench {
+
+// ------------------ State ------------------
+
+State::State(int64_t max_iterations, int64_t arg)
+    : max_iterations_(max_iterations), arg_(arg)
+{
+}
+
+bool State::KeepRunning() {
+    if (!is_running_) {
+        is_running_ = true;
+        start_ = Clock::now();
+    }
+    if (done_iterations_ < max_iterations_) {
+        ++done_iterations_;
+        return true;
+    }
+    elapsed_ += Clock::now() - start_;
+    is_running_ = false;
+    return false;
+}
+
+void State::PauseTiming() {
+    elapsed_ += Clock::now() - start_;
+}
+
+void State::ResumeTiming() {
+    start_ = Clock::now();
+}
+
+// ------------------ Benchmark ------------------
+
+Benchmark::Benchmark(std::string name, std::function<void(State&)> func)
+    : name_(std::move(name)), func_(std::move(func))
+{
+}
+
+Benchmark* Benchmark::Arg(int64_t arg) {
+    args_.push_back(arg);
+    return this;
+}
+
+Benchmark* Benchmark::Range(int64_t lo, int64_t hi, int64_t multiplier) {
+    for (int64_t arg = lo; arg < hi; arg *= multiplier) {
+        args_.push_back(arg);
+    }
+    args_.push_back(hi);
+    return this;
+}
+
+static std::vector<std::unique_ptr<Benchmark>>& Registry() {
+    static std::vector<std::unique_ptr<Benchmark>> registry;
+    return registry;
+}
+
+Benchmark* RegisterBenchmark(std::string name, std::function<void(State&)> func) {
+    Registry().push_back(std::make_unique<Benchmark>(std::move(name), std::move(func)));
+    return Registry().back().get();
+}
+
+// ------------------ Runner ------------------
+
+struct Result {
+    std::string name;
+    int64_t iterations = 0;
+    double ns_per_iteration = 0;
+    double items_per_second = 0;
+};
+
+static Result RunOne(const Benchmark& benchmark, int64_t arg, bool has_arg, double min_time) {
+
+    // Grow the iteration count until one run lasts at least min_time
+    int64_t iterations = 1;
+    while (true) {
+        State state(iterations, arg);
+        benchmark.Run(state);
+
+        const double seconds = std::chrono::duration<double>(state.GetElapsed()).count();
+
+        if (seconds >= min_time || iterations >= 1'000'000'000) {
+            Result result;
+            result.name = has_arg ? benchmark.GetName() + "/"s + std::to_string(arg) : benchmark.GetName();
+            result.iterations = iterations;
+            result.ns_per_iteration = seconds * 1e9 / iterations;
+            if (state.GetItemsProcessed() > 0 && seconds > 0) {
+                result.items_per_second = state.GetItemsProcessed() / seconds;
+            }
+            return result;
+        }
+
+        const double factor = seconds > 0 ? std::min(10.0, min_time * 1.4 / seconds) : 10.0;
+        iterations = std::max(iterations + 1, static_cast<int64_t>(iterations * factor));
+    }
+}
+
+static std::map<std::string, double> ReadBaseline(const std::string& path) {
+    std::ifstream input(path);
+    if (!input) {
+        throw std::runtime_error("Unable to open baseline "s + path);
+    }
+    const auto document = json::Load(input);
+    std::map<std::string, double> baseline;
+    for (const auto& item : document.GetRoot().AsArray()) {
+        baseline[item.AsDict().at("name"s).AsString()] = item.AsDict().at("ns_per_iteration"s).AsDouble();
+    }
+    return baseline;
+}
+
+int RunAll(int argc, char* argv[]) {
+
+    std::string filter;
+    double min_time = 0.2;
+    std::string json_path;
+    std::string baseline_path;
+
+    for (int index = 1; index + 1 < argc; index += 2) {
+        const std::string_view option(argv[index]);
+        if (option == "--filter"sv) {
+            filter = argv[index + 1];
+        } else if (option == "--min-time"sv) {
+            min_time = std::stod(argv[index + 1]);
+        } else if (option == "--json"sv) {
+            json_path = argv[index + 1];
+        } else if (option == "--baseline"sv) {
+            baseline_path = argv[index + 1];
+        } else {
+            std::cerr << "Unknown option "sv << option << std::endl;
+            return 1;
+        }
+    }
+
+    const auto baseline = baseline_path.empty() ? std::map<std::string, double>{} : ReadBaseline(baseline_path);
+
+    std::cout << std::left << std::setw(48) << "Benchmark"s << std::right << std::setw(16) << "ns/iter"s
+              << std::setw(14) << "iterations"s << std::setw(16) << "items/s"s
+              << (baseline.empty() ? ""s : "     vs baseline"s) << std::endl;
+
+    json::Array results;
+
+    for (const auto& benchmark : Registry()) {
+
+        std::vector<std::pair<int64_t, bool>> runs;
+        for (int64_t arg : benchmark->GetArgs()) {
+            runs.emplace_back(arg, true);
+        }
+        if (runs.empty()) {
+            runs.emplace_back(0, false);
+        }
+
+        for (const auto& [arg, has_arg] : runs) {
+
+            const std::string name = has_arg ? benchmark->GetName() + "/"s + std::to_string(arg) : benchmark->GetName();
+            if (!filter.empty() && name.find(filter) == std::string::npos) {
+                continue;
+            }
+
+            const auto result = RunOne(*benchmark, arg, has_arg, min_time);
+
+            std::cout << std::left << std::setw(48) << result.name << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(16) << result.ns_per_iteration << std::setw(14) << result.iterations
+                      << std::setw(16) << std::setprecision(0) << result.items_per_second;
+            if (auto it = baseline.find(result.name); it != baseline.end() && it->second > 0) {
+                std::cout << std::setw(15) << std::showpos << std::setprecision(1)
+                          << (result.ns_per_iteration / it->second - 1.0) * 100 << "%"sv << std::noshowpos;
+            }
+            std::cout << std::defaultfloat << std::endl;
+
+            results.emplace_back(json::Builder{}.StartDict()
+                    .Key("name"s).Value(result.name)
+                    .Key("iterations"s).Value(static_cast<double>(result.iterations))
+                    .Key("ns_per_iteration"s).Value(result.ns_per_iteration)
+                    .Key("items_per_second"s).Value(result.items_per_second)
+                    .EndDict().Build());
+        }
+    }
+
+    if (!json_path.empty()) {
+        std::ofstream output(json_path);
+        json::Print(json::Document(results), output);
+    }
+
+    return 0;
+}
+
+} // end namespace microbench
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Minimal Google-Benchmark-style framework, so the suite builds without external dependencies.
+//
+//     void BM_Something(microbench::State& state) {
+//         auto input = MakeInput(state.range());   // not timed
+//         while (state.KeepRunning()) {
+//             microbench::DoNotOptimize(Work(input));
+//         }
+//         state.SetItemsProcessed(state.iterations() * state.range());
+//     }
+//     MICROBENCH(BM_Something)->Range(8, 4096);
+
+namespace microbench {
+
+class State {
+public:
+    State(int64_t max_iterations, int64_t arg);
+
+    // Returns true while the measured loop has to continue, the first call starts the timer
+    bool KeepRunning();
+
+    // Excludes the code between the calls from the measured time
+    void PauseTiming();
+    void ResumeTiming();
+
+    int64_t range() const {
+        return arg_;
+    }
+
+    int64_t iterations() const {
+        return max_iterations_;
+    }
+
+    void SetItemsProcessed(int64_t items) {
+        items_processed_ = items;
+    }
+
+    int64_t GetItemsProcessed() const {
+        return items_processed_;
+    }
+
+    std::chrono::nanoseconds GetElapsed() const {
+        return elapsed_;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    int64_t max_iterations_;
+    int64_t done_iterations_ = 0;
+    int64_t arg_;
+    int64_t items_processed_ = 0;
+
+    bool is_running_ = false;
+    Clock::time_point start_;
+    std::chrono::nanoseconds elapsed_{0};
+};
+
+class Benchmark {
+public:
+    Benchmark(std::string name, std::function<void(State&)> func);
+
+    // Runs the benchmark with one more argument value
+    Benchmark* Arg(int64_t arg);
+
+    // Adds lo, lo * multiplier, ... up to and including hi
+    Benchmark* Range(int64_t lo, int64_t hi, int64_t multiplier = 8);
+
+    const std::string& GetName() const {
+        return name_;
+    }
+
+    const std::vector<int64_t>& GetArgs() const {
+        return args_;
+    }
+
+    void Run(State& state) const {
+        func_(state);
+    }
+
+private:
+    std::string name_;
+    std::function<void(State&)> func_;
+    std::vector<int64_t> args_;
+};
+
+Benchmark* RegisterBenchmark(std::string name, std::function<void(State&)> func);
+
+// Options: --filter SUBSTRING, --min-time SECONDS, --json FILE (write results),
+//          --baseline FILE (compare with results written earlier)
+int RunAll(int argc, char* argv[]);
+
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template <typename T>
+inline void DoNotOptimize(T& value) {
+    asm volatile("" : "+r,m"(value) : : "memory");
+}
+
+} // end namespace microbench
+
+#define MICROBENCH_CONCAT_IMPL(a, b) a##b
+#define MICROBENCH_CONCAT(a, b) MICROBENCH_CONCAT_IMPL(a, b)
+
+#define MICROBENCH(func) \
+    static ::microbench::Benchmark* MICROBENCH_CONCAT(microbench_registered_, __LINE__) = \
+        ::microbench::RegisterBenchmark(#func, func)
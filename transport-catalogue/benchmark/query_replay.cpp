@@ -0,0 +1,195 @@
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "histogram.h"
+#include "json.h"
+#include "json_builder.h"
+#include "json_reader.h"
+#include "profile.h"
+#include "query_log.h"
+#include "serialization.h"
+#include "transport_catalogue.h"
+
+using namespace std::literals;
+
+// Replays a stat_requests capture (process_requests --capture=FILE) against a base file.
+// Every stream owns a catalogue and a JsonReader loaded from the base and sends the whole
+// capture, at the captured pace divided by --rate or back to back with --rate 0.
+
+struct Options {
+    std::string capture_path;
+    std::string base_path;
+    double rate = 1.0;
+    int streams = 1;
+};
+
+// Catalogue and reader of one stream, they are not shared between the threads
+struct Stream {
+    transport_catalogue::TransportCatalogue catalogue;
+    std::unique_ptr<JsonReader> reader;
+
+    // Service time by request type and time since the scheduled arrival of the request
+    std::map<std::string, profile::Histogram> latency;
+    profile::Histogram response;
+};
+
+void PrintUsage() {
+    std::cerr << "Usage: query_replay <capture.json> [--base FILE] [--rate MULTIPLIER] [--streams N]\n"sv
+              << "  --base     base file, serialization_settings of the capture by default\n"sv
+              << "  --rate     speed-up of the captured pace, 0 replays without pauses (default 1)\n"sv
+              << "  --streams  number of concurrent replay streams (default 1)\n"sv;
+}
+
+bool ParseOptions(int argc, char* argv[], Options& options) {
+    if (argc < 2 || argc % 2 != 0) {
+        return false;
+    }
+    options.capture_path = argv[1];
+    for (int index = 2; index + 1 < argc; index += 2) {
+        const std::string_view option(argv[index]);
+        if (option == "--base"sv) {
+            options.base_path = argv[index + 1];
+        } else if (option == "--rate"sv) {
+            options.rate = std::stod(argv[index + 1]);
+        } else if (option == "--streams"sv) {
+            options.streams = std::stoi(argv[index + 1]);
+        } else {
+            return false;
+        }
+    }
+    return options.rate >= 0 && options.streams > 0;
+}
+
+void LoadStream(const proto_catalogue::TransportCatalogue& base, Stream& stream) {
+    stream.reader = std::make_unique<JsonReader>(&stream.catalogue);
+    serial_database::FillCatalogue(base, stream.catalogue);
+    stream.reader->SetRenderSettings(serial_database::DeserializeRenderSettings(base));
+    serial_database::DeserializeRouter(stream.catalogue, base.router());
+}
+
+void RunStream(const std::vector<query_log::Entry>& entries, double rate,
+               query_log::Clock::time_point start, Stream& stream) {
+
+    for (const auto& entry : entries) {
+        auto scheduled = start;
+        if (rate > 0) {
+            scheduled += std::chrono::duration_cast<query_log::Clock::duration>(
+                    std::chrono::duration<double, std::milli>(entry.offset_ms / rate));
+            std::this_thread::sleep_until(scheduled);
+        }
+
+        const auto request_start = query_log::Clock::now();
+        stream.reader->ProcessRequest(entry.request);
+        const auto request_finish = query_log::Clock::now();
+
+        const auto to_ns = [](query_log::Clock::duration duration) {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+        };
+        stream.latency[entry.request.at("type"s).AsString()].Record(to_ns(request_finish - request_start));
+        if (rate > 0) {
+            stream.response.Record(to_ns(request_finish - scheduled));
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+
+    std::vector<query_log::Entry> entries;
+    std::string base_path = options.base_path;
+    try {
+        std::ifstream capture_file(options.capture_path);
+        if (!capture_file) {
+            throw std::runtime_error("Unable to open "s + options.capture_path);
+        }
+        const auto capture = json::Load(capture_file);
+        entries = query_log::LoadEntries(capture);
+        if (base_path.empty()) {
+            base_path = capture.GetRoot().AsDict().at("serialization_settings"s).AsDict().at("file"s).AsString();
+        }
+    } catch (const std::exception& error) {
+        std::cerr << "Failed to read the capture: "sv << error.what() << std::endl;
+        return 1;
+    }
+
+    std::ifstream base_file(base_path, std::ios::binary);
+    if (!base_file) {
+        std::cerr << "Unable to open base "sv << base_path << std::endl;
+        return 1;
+    }
+    const auto base = serial_database::DeserializeFile(base_file);
+
+    std::vector<Stream> streams(options.streams);
+    for (auto& stream : streams) {
+        LoadStream(base, stream);
+    }
+
+    // All streams start together after the loading
+    const auto start = query_log::Clock::now();
+
+    std::vector<std::thread> threads;
+    threads.reserve(streams.size());
+    for (auto& stream : streams) {
+        threads.emplace_back([&entries, &options, start, &stream] {
+            RunStream(entries, options.rate, start, stream);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    const double wall_ms = std::chrono::duration<double, std::milli>(query_log::Clock::now() - start).count();
+
+    std::map<std::string, profile::Histogram> latency;
+    profile::Histogram total;
+    profile::Histogram response;
+    for (const auto& stream : streams) {
+        for (const auto& [type, histogram] : stream.latency) {
+            latency[type].Merge(histogram);
+            total.Merge(histogram);
+        }
+        response.Merge(stream.response);
+    }
+
+    json::Dict latency_report;
+    for (const auto& [type, histogram] : latency) {
+        latency_report.emplace(type, profile::ToJson(histogram));
+    }
+    latency_report.emplace("all"s, profile::ToJson(total));
+
+    const double requests = static_cast<double>(entries.size()) * options.streams;
+
+    json::Builder report;
+    report.StartDict()
+            .Key("capture"s).Value(options.capture_path)
+            .Key("base"s).Value(base_path)
+            .Key("streams"s).Value(options.streams)
+            .Key("rate"s).Value(options.rate)
+            .Key("requests"s).Value(requests)
+            .Key("wall_ms"s).Value(wall_ms)
+            .Key("throughput_rps"s).Value(wall_ms > 0 ? requests / wall_ms * 1000.0 : 0.0)
+            .Key("latency_us"s).Value(std::move(latency_report));
+    if (options.rate > 0) {
+        report.Key("response_us"s).Value(profile::ToJson(response));
+    }
+    report.EndDict();
+
+    json::Print(json::Document(report.Build()), std::cout);
+    std::cout << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include "connection_scan.h"
+
+#include <algorithm>
+
+#include "profile.h"
+
+namespace transport_catalogue {
+
+    ConnectionScanRouter::ConnectionScanRouter(const RouterSettings& settings, const std::deque<Route>& routes,
+                                               size_t stop_count)
+        : stop_count_(stop_count)
+    {
+        // Coefficient from km/h to meters/minute = 0.06;
+        static const double MULTIPLY_COEF = 0.06;
+
+        for (const auto& route : routes) {
+            if (route.stops.size() < 2 || route.departures.empty()) {
+                continue;
+            }
+
+            std::vector<double> run_times = route.run_times;
+            if (run_times.size() + 1 != route.stops.size()) {
+                run_times.clear();
+                for (size_t index = 0; index + 1 < route.stops.size(); ++index) {
+                    run_times.push_back(MULTIPLY_COEF * route.GetRideDistance(index, index + 1) / settings.bus_velocity_);
+                }
+            }
+
+            for (const double departure : route.departures) {
+                const auto trip = static_cast<uint32_t>(trip_routes_.size());
+                trip_routes_.push_back(&route);
+
+                double time = departure;
+                for (size_t index = 0; index + 1 < route.stops.size(); ++index) {
+                    connections_.push_back(Connection{time,
+                                                      time + run_times[index],
+                                                      static_cast<uint32_t>(route.stops[index]->id),
+                                                      static_cast<uint32_t>(route.stops[index + 1]->id),
+                                                      trip,
+                                                      static_cast<uint32_t>(index)});
+                    time += run_times[index];
+                }
+            }
+        }
+
+        // Stable, so connections of one trip with zero run times keep their order
+        std::stable_sort(connections_.begin(), connections_.end(), [](const Connection& lhs, const Connection& rhs) {
+            return lhs.departure < rhs.departure;
+        });
+    }
+
+    std::optional<TimetableJourney> ConnectionScanRouter::FindJourney(VertexId from, VertexId to,
+                                                                       double departure_time) const {
+
+        if (from == to) {
+            return TimetableJourney{{}, departure_time};
+        }
+
+        std::vector<double> earliest(stop_count_, std::numeric_limits<double>::infinity());
+        std::vector<uint32_t> trip_board(trip_routes_.size(), NO_CONNECTION);
+        std::vector<Leg> legs(stop_count_);
+        earliest[from] = departure_time;
+
+        auto first = std::lower_bound(connections_.begin(), connections_.end(), departure_time,
+                                      [](const Connection& connection, double time) {
+                                          return connection.departure < time;
+                                      });
+
+        uint64_t scanned = 0;
+        for (auto it = first; it != connections_.end() && it->departure < earliest[to]; ++it) {
+            ++scanned;
+            const auto& connection = *it;
+            auto& board = trip_board[connection.trip];
+
+            if (board == NO_CONNECTION) {
+                if (earliest[connection.from] > connection.departure) {
+                    continue;
+                }
+                board = static_cast<uint32_t>(it - connections_.begin());
+            }
+
+            if (connection.arrival < earliest[connection.to]) {
+                earliest[connection.to] = connection.arrival;
+                legs[connection.to] = Leg{board, static_cast<uint32_t>(it - connections_.begin())};
+            }
+        }
+        profile::Count("csa.scanned_connections", scanned);
+
+        if (legs[to].alight == NO_CONNECTION) {
+            return std::nullopt;
+        }
+
+        TimetableJourney journey;
+        journey.arrival = earliest[to];
+        for (VertexId stop = to; stop != from; ) {
+            const auto& board = connections_[legs[stop].board];
+            const auto& alight = connections_[legs[stop].alight];
+            journey.rides.push_back(TimetableRide{trip_routes_[board.trip],
+                                                  static_cast<int>(board.position),
+                                                  static_cast<int>(alight.position) + 1,
+                                                  board.departure,
+                                                  alight.arrival});
+            stop = board.from;
+        }
+        std::reverse(journey.rides.begin(), journey.rides.end());
+
+        return journey;
+    }
+
+} // end of namespace: transport_catalogue
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include "domain.h"
+#include "transport_router.h"
+
+namespace transport_catalogue {
+
+    // One ride of a timetable journey: the trip covers route_ptr->stops from from_index to to_index
+    struct TimetableRide {
+        const Route* route_ptr = nullptr;
+        int from_index = 0;
+        int to_index = 0;
+        double departure = 0.0;
+        double arrival = 0.0;
+    };
+
+    struct TimetableJourney {
+        std::vector<TimetableRide> rides;
+        double arrival = 0.0;
+    };
+
+// Earliest arrival search over the timetables of the routes (Connection Scan Algorithm). Every trip is
+// split into connections, departures from one stop to the next, kept in one array sorted by departure.
+// A query scans the array once from the given time: a connection is taken if its trip is already
+// boarded or its stop is reached by then, and the scan stops at the earliest arrival at the target.
+class ConnectionScanRouter {
+public:
+
+    // Routes without departures are skipped. The distances of the routes are to be filled,
+    // see Route::forward_distances, they give the run times the timetables do not have
+    ConnectionScanRouter(const RouterSettings& settings, const std::deque<Route>& routes, size_t stop_count);
+
+    // nullopt if the target can not be reached after departure_time
+    std::optional<TimetableJourney> FindJourney(VertexId from, VertexId to, double departure_time) const;
+
+    size_t GetConnectionCount() const {
+        return connections_.size();
+    }
+
+private:
+    static constexpr uint32_t NO_CONNECTION = std::numeric_limits<uint32_t>::max();
+
+    struct Connection {
+        double departure = 0.0;
+        double arrival = 0.0;
+        uint32_t from = 0;
+        uint32_t to = 0;
+        uint32_t trip = 0;
+        // Index of the departure stop in the route
+        uint32_t position = 0;
+    };
+
+    // Connections of the ride which reached a stop first: where the trip was boarded and where it was left
+    struct Leg {
+        uint32_t board = NO_CONNECTION;
+        uint32_t alight = NO_CONNECTION;
+    };
+
+    size_t stop_count_ = 0;
+    std::vector<const Route*> trip_routes_;
+    std::vector<Connection> connections_;
+};
+
+} // end of namespace: transport_catalogue
@@ -33,6 +33,11 @@ std::size_t RouteAdditionalParameters::CalculateUniqueStops() {
     return unique_stops;
 }
 
+int Route::GetRideDistance(std::size_t from, std::size_t to) const {
+    return from <= to ? forward_distances[to] - forward_distances[from]
+                      : backward_distances[from] - backward_distances[to];
+}
+
 bool Stop::operator==(const Stop& other) const {
     return name == other.name;
 }
@@ -61,6 +61,22 @@ struct Route {
     std::string name;
     bool is_roundtrip;
     int id;
+
+    // Road distances accumulated along the stops, filled by the catalogue before they are used
+    // and dropped when the route or its distances change. forward_distances[i] is the way from
+    // stops[0] to stops[i], backward_distances[i] the way from stops[i] back to stops[0].
+    std::vector<int> forward_distances;
+    std::vector<int> backward_distances;
+
+    // Road distance of a ride from stops[from] to stops[to] in either direction
+    int GetRideDistance(std::size_t from, std::size_t to) const;
+
+    // Timetable, empty if the route has none. Departures of the trips from stops[0] in minutes
+    // after midnight, in ascending order. A trip passes all the stops, a non-round route there
+    // and back. run_times[i] is the time from stops[i] to stops[i + 1], without them the times
+    // follow from the distances and the bus velocity.
+    std::vector<double> departures;
+    std::vector<double> run_times;
 };
 
 struct RouteAdditionalParameters {
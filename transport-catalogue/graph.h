@@ -2,7 +2,9 @@
 
 #include "ranges.h"
 
+#include <algorithm>
 #include <cstdlib>
+#include <limits>
 #include <vector>
 
 namespace graph {
@@ -32,6 +34,18 @@ public:
     }
     EdgeId AddEdge(const Edge<Weight>& edge);
 
+    // Adds a vertex without edges and returns its id
+    VertexId AddVertex();
+
+    // Detaches the edge from its incidence list, the id stays reserved until Compact()
+    void RemoveEdge(EdgeId edge_id);
+
+    // Drops the removed edges and renumbers the others keeping their order.
+    // Returns the new id of every old edge id, REMOVED_EDGE for the dropped ones.
+    std::vector<EdgeId> Compact();
+
+    static constexpr EdgeId REMOVED_EDGE = std::numeric_limits<EdgeId>::max();
+
     size_t GetVertexCount() const;
     size_t GetEdgeCount() const;
     const Edge<Weight>& GetEdge(EdgeId edge_id) const;
@@ -53,6 +67,11 @@ public:
         incidence_lists_ = std::move(incidence_lists);
     }
 
+    // Replaces the edges going out of the vertex, the detached ones are dropped by Compact()
+    void SetIncidentEdges(VertexId vertex, IncidenceList&& incidence_list) {
+        incidence_lists_.at(vertex) = std::move(incidence_list);
+    }
+
 private:
     std::vector<Edge<Weight>> edges_;
     std::vector<IncidenceList> incidence_lists_;
@@ -71,6 +90,47 @@ EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
     return id;
 }
 
+template <typename Weight>
+VertexId DirectedWeightedGraph<Weight>::AddVertex() {
+    incidence_lists_.emplace_back();
+    return incidence_lists_.size() - 1;
+}
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::RemoveEdge(EdgeId edge_id) {
+    auto& incidence_list = incidence_lists_.at(edges_.at(edge_id).from);
+    incidence_list.erase(std::remove(incidence_list.begin(), incidence_list.end(), edge_id), incidence_list.end());
+}
+
+template <typename Weight>
+std::vector<EdgeId> DirectedWeightedGraph<Weight>::Compact() {
+
+    // An edge is alive while it is referenced by an incidence list
+    std::vector<EdgeId> new_ids(edges_.size(), REMOVED_EDGE);
+    for (const auto& incidence_list : incidence_lists_) {
+        for (const EdgeId edge_id : incidence_list) {
+            new_ids[edge_id] = 0;
+        }
+    }
+
+    EdgeId next_id = 0;
+    for (EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+        if (new_ids[edge_id] != REMOVED_EDGE) {
+            new_ids[edge_id] = next_id;
+            edges_[next_id++] = edges_[edge_id];
+        }
+    }
+    edges_.resize(next_id);
+
+    for (auto& incidence_list : incidence_lists_) {
+        for (EdgeId& edge_id : incidence_list) {
+            edge_id = new_ids[edge_id];
+        }
+    }
+
+    return new_ids;
+}
+
 template <typename Weight>
 size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
     return incidence_lists_.size();
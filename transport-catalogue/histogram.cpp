@@ -0,0 +1,87 @@
+#include "histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace profile {
+
+static int HighestBit(uint64_t value) {
+    int bit = 0;
+    while (value >>= 1) {
+        ++bit;
+    }
+    return bit;
+}
+
+size_t Histogram::BucketIndex(uint64_t value) {
+    // Values below 2 * SUB_BUCKET_COUNT are stored exactly
+    if (value < 2 * SUB_BUCKET_COUNT) {
+        return static_cast<size_t>(value);
+    }
+    const int shift = HighestBit(value) - SUB_BUCKET_BITS;
+    return static_cast<size_t>(shift) * SUB_BUCKET_COUNT + static_cast<size_t>(value >> shift);
+}
+
+uint64_t Histogram::BucketValue(size_t index) {
+    if (index < 2 * SUB_BUCKET_COUNT) {
+        return index;
+    }
+    const size_t shift = index / SUB_BUCKET_COUNT - 1;
+    const uint64_t mantissa = index - shift * SUB_BUCKET_COUNT;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void Histogram::Record(uint64_t value) {
+    AddToBucket(BucketIndex(value), 1);
+}
+
+void Histogram::AddToBucket(size_t index, uint64_t count) {
+    counts_[index] += count;
+    count_ += count;
+}
+
+void Histogram::Merge(const Histogram& other) {
+    for (size_t index = 0; index < BUCKET_COUNT; ++index) {
+        counts_[index] += other.counts_[index];
+    }
+    count_ += other.count_;
+}
+
+uint64_t Histogram::ValueAtPercentile(double percentile) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    // Rank of the requested value, at least the first one
+    const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * count_)));
+
+    uint64_t seen = 0;
+    for (size_t index = 0; index < BUCKET_COUNT; ++index) {
+        seen += counts_[index];
+        if (seen >= rank) {
+            return BucketValue(index);
+        }
+    }
+    return GetMax();
+}
+
+uint64_t Histogram::GetMax() const {
+    for (size_t index = BUCKET_COUNT; index > 0; --index) {
+        if (counts_[index - 1] > 0) {
+            return BucketValue(index - 1);
+        }
+    }
+    return 0;
+}
+
+double Histogram::GetMean() const {
+    if (count_ == 0) {
+        return 0;
+    }
+    double total = 0;
+    for (size_t index = 0; index < BUCKET_COUNT; ++index) {
+        total += static_cast<double>(counts_[index]) * static_cast<double>(BucketValue(index));
+    }
+    return total / static_cast<double>(count_);
+}
+
+} // end namespace profile
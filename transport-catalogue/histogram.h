@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace profile {
+
+// HDR-style log-linear histogram of non-negative integer values (nanoseconds for latencies).
+// Every power of two is split into SUB_BUCKET_COUNT buckets, so the relative error of a
+// reported value is below 1 / SUB_BUCKET_COUNT, from one nanosecond to the whole uint64 range.
+class Histogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 5;
+    static constexpr uint64_t SUB_BUCKET_COUNT = uint64_t(1) << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    static size_t BucketIndex(uint64_t value);
+
+    // The largest value that falls into the bucket
+    static uint64_t BucketValue(size_t index);
+
+    void Record(uint64_t value);
+
+    // Adds count values that fall into the bucket with the index
+    void AddToBucket(size_t index, uint64_t count);
+
+    void Merge(const Histogram& other);
+
+    // percentile is in [0, 100], returns 0 for an empty histogram
+    uint64_t ValueAtPercentile(double percentile) const;
+
+    uint64_t GetCount() const {
+        return count_;
+    }
+
+    uint64_t GetMax() const;
+
+    double GetMean() const;
+
+private:
+    std::array<uint64_t, BUCKET_COUNT> counts_{};
+    uint64_t count_ = 0;
+};
+
+} // end namespace profile
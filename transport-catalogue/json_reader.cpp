@@ -1,12 +1,21 @@
 
+#include <algorithm>
+#include <iterator>
+#include <optional>
+#include <set>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
+#include <utility>
 
 #include "json.h"
 #include "map_renderer.h"
 #include "transport_catalogue.h"
 #include "geo.h"
 #include "json_reader.h"
+#include "profile.h"
 
 using namespace json;
 using namespace transport_catalogue;
@@ -27,41 +36,519 @@ void JsonReader::FillCatalogue() {
     AddAllStops();
     AddAllDistances();
     AddAllRoutes();
+    AddAllTimetables();
 
 }
     
-void JsonReader::ProcessRequests() {
-    
-    const auto& stat_requests = all_objects_.GetRoot().AsDict().at("stat_requests"s).AsArray();
-    
-    for (const auto& i : stat_requests) {
+std::string_view JsonReader::GetUpdateAction(const Dict& request) {
+
+    auto it = request.find("action"s);
+    if (it == request.end()) {
+        return {};
+    }
+
+    const auto& action = it->second.AsString();
+    if (action != "add"s && action != "modify"s && action != "remove"s) {
+        throw std::invalid_argument("Unknown action "s + action);
+    }
+    return action;
+}
+
+void JsonReader::ApplyUpdates() {
+    ApplyUpdates(all_objects_.GetRoot().AsDict().at("base_requests"s).AsArray());
+}
+
+namespace {
+
+// Fields of update requests, a missing or malformed one is named in the message
+const Node& UpdateField(const Dict& request, const std::string& key) {
+    auto it = request.find(key);
+    if (it == request.end()) {
+        throw std::invalid_argument("Update request has no \""s + key + "\""s);
+    }
+    return it->second;
+}
+
+const std::string& UpdateString(const Dict& request, const std::string& key) {
+    const Node& node = UpdateField(request, key);
+    if (!node.IsString()) {
+        throw std::invalid_argument("\""s + key + "\" of an update request should be a string"s);
+    }
+    return node.AsString();
+}
+
+void CheckUpdateNumbers(const Dict& request, const std::string& key) {
+    const Node& node = UpdateField(request, key);
+    if (!node.IsArray() || std::any_of(node.AsArray().begin(), node.AsArray().end(),
+                                       [](const Node& number) { return !number.IsDouble(); })) {
+        throw std::invalid_argument("\""s + key + "\" of an update request should be an array of numbers"s);
+    }
+}
+
+void CheckUpdateDistance(const std::string& from, const std::string& to, const Node& distance) {
+    if (!distance.IsInt() || distance.AsInt() < 0) {
+        throw std::invalid_argument("Distance from "s + from + " to "s + to + " should be a non-negative integer"s);
+    }
+}
+
+} // end of namespace
+
+void JsonReader::ValidateUpdates(const json::Array& base_requests) const {
+
+    // The batch is replayed on names only, in the order of ApplyUpdates(). An entry in the maps
+    // overrides the catalogue: nullopt for removed, otherwise the stops of a bus and is_roundtrip.
+    std::unordered_map<std::string, bool> stop_exists;
+    std::unordered_map<std::string, std::optional<std::pair<std::vector<std::string>, bool>>> buses;
+    std::set<std::pair<std::string, std::string>> distances;
+    std::set<std::pair<std::string, std::string>> removed_distances;
+
+    auto is_stop = [&](const std::string& name) {
+        auto it = stop_exists.find(name);
+        return it != stop_exists.end() ? it->second : catalogue_ptr_->IsStopExist(name);
+    };
+    auto is_bus = [&](const std::string& name) {
+        auto it = buses.find(name);
+        return it != buses.end() ? it->second.has_value() : catalogue_ptr_->IsRouteExist(name);
+    };
+    auto check_stop = [&](const std::string& name) {
+        if (!is_stop(name)) {
+            throw std::out_of_range("Unknown stop "s + name);
+        }
+    };
+
+    for (const auto& i : base_requests) {
+        if (!i.IsDict()) {
+            throw std::invalid_argument("Update request should be a dictionary"s);
+        }
         const auto& request = i.AsDict();
+        const auto& type = UpdateString(request, "type"s);
+        if (type != "Stop"s && type != "Bus"s && type != "Distance"s && type != "Timetable"s) {
+            throw std::invalid_argument("Unknown update request type "s + type);
+        }
+        if (request.count("action"s) != 0 && !request.at("action"s).IsString()) {
+            throw std::invalid_argument("\"action\" of an update request should be a string"s);
+        }
+        GetUpdateAction(request);
+        if (type == "Stop"s && GetUpdateAction(request) == "remove"sv) {
+            continue;
+        }
+        if (type == "Stop"s) {
+            const auto& name = UpdateString(request, "name"s);
+            const bool exists = is_stop(name);
+            if (exists && GetUpdateAction(request) == "add"sv) {
+                throw std::logic_error("Stop "s + name + " already exists"s);
+            }
+            if (!exists && GetUpdateAction(request) == "modify"sv) {
+                throw std::out_of_range("Unknown stop "s + name);
+            }
+            if (!UpdateField(request, "latitude"s).IsDouble() || !UpdateField(request, "longitude"s).IsDouble()) {
+                throw std::invalid_argument("Coordinates of stop "s + name + " should be numbers"s);
+            }
+            stop_exists[name] = true;
+        }
+    }
 
-        if (request.at("type"s).AsString() == "Stop"s) {
-            ProcessStopRequest(request);
+    for (const auto& i : base_requests) {
+        const auto& request = i.AsDict();
+        const auto& type = request.at("type"s).AsString();
+        if (GetUpdateAction(request) == "remove"sv) {
+            continue;
         }
-        
-        if (request.at("type"s).AsString() == "Bus"s) {
-            ProcessRouteRequest(request);
+        if (type == "Stop"s && request.count("road_distances"s) != 0) {
+            const auto& name = request.at("name"s).AsString();
+            if (!request.at("road_distances"s).IsDict()) {
+                throw std::invalid_argument("Road distances of stop "s + name + " should be a dictionary"s);
+            }
+            for (const auto& [to, distance] : request.at("road_distances"s).AsDict()) {
+                check_stop(to);
+                CheckUpdateDistance(name, to, distance);
+                distances.insert({name, to});
+            }
+        }
+        if (type == "Distance"s) {
+            const auto& from = UpdateString(request, "from"s);
+            const auto& to = UpdateString(request, "to"s);
+            check_stop(from);
+            check_stop(to);
+            CheckUpdateDistance(from, to, UpdateField(request, "distance"s));
+            distances.insert({from, to});
         }
+    }
 
-        if (request.at("type"s).AsString() == "Route"s) {
-            // Lasy Initialization. Heavy graph will be created only if this request type is called.
-            if (!catalogue_ptr_->RouterExist()) {
-                const auto& routing_settings = all_objects_.GetRoot().AsDict().at("routing_settings"s).AsDict();
+    for (const auto& i : base_requests) {
+        const auto& request = i.AsDict();
+        if (request.at("type"s).AsString() != "Bus"s) {
+            continue;
+        }
+        const auto& name = UpdateString(request, "name"s);
+        const auto action = GetUpdateAction(request);
+        const bool exists = is_bus(name);
+
+        if (action == "remove"sv) {
+            if (!exists) {
+                throw std::out_of_range("Unknown bus "s + name);
+            }
+            buses[name] = std::nullopt;
+            continue;
+        }
+
+        if (exists && action == "add"sv) {
+            throw std::logic_error("Bus "s + name + " already exists"s);
+        }
+        if (!exists && action == "modify"sv) {
+            throw std::out_of_range("Unknown bus "s + name);
+        }
+        const Node& stops = UpdateField(request, "stops"s);
+        if (!stops.IsArray() || std::any_of(stops.AsArray().begin(), stops.AsArray().end(),
+                                            [](const Node& stop) { return !stop.IsString(); })) {
+            throw std::invalid_argument("Stops of bus "s + name + " should be an array of names"s);
+        }
+        if (stops.AsArray().empty()) {
+            throw std::invalid_argument("Bus "s + name + " has no stops"s);
+        }
+        if (!UpdateField(request, "is_roundtrip"s).IsBool()) {
+            throw std::invalid_argument("\"is_roundtrip\" of bus "s + name + " should be a boolean"s);
+        }
+        for (const auto& stop : stops.AsArray()) {
+            check_stop(stop.AsString());
+        }
+        buses[name] = std::make_pair(RouteStopNames(request), request.at("is_roundtrip"s).AsBool());
+    }
+
+    for (const auto& i : base_requests) {
+        const auto& request = i.AsDict();
+        if (request.at("type"s).AsString() != "Timetable"s) {
+            continue;
+        }
+        const auto& name = UpdateString(request, "bus"s);
+        if (!is_bus(name)) {
+            throw std::out_of_range("Unknown bus "s + name);
+        }
+        if (GetUpdateAction(request) == "remove"sv) {
+            continue;
+        }
+
+        CheckUpdateNumbers(request, "departures"s);
+        std::vector<double> departures;
+        for (const auto& number : request.at("departures"s).AsArray()) {
+            departures.push_back(number.AsDouble());
+        }
+        std::vector<double> run_times;
+        if (request.count("run_times"s) != 0) {
+            CheckUpdateNumbers(request, "run_times"s);
+            for (const auto& number : request.at("run_times"s).AsArray()) {
+                run_times.push_back(number.AsDouble());
+            }
+        }
+
+        auto it = buses.find(name);
+        const Route* route_ptr = it == buses.end() ? catalogue_ptr_->GetRoutePtr(name) : nullptr;
+        TransportCatalogue::CheckTimetable(name,
+                                           route_ptr != nullptr ? route_ptr->is_roundtrip : it->second->second,
+                                           route_ptr != nullptr ? route_ptr->stops.size() : it->second->first.size(),
+                                           departures, run_times);
+    }
+
+    for (const auto& i : base_requests) {
+        const auto& request = i.AsDict();
+        if (request.at("type"s).AsString() != "Distance"s || GetUpdateAction(request) != "remove"sv) {
+            continue;
+        }
+        const auto& from = UpdateString(request, "from"s);
+        const auto& to = UpdateString(request, "to"s);
+        check_stop(from);
+        check_stop(to);
+        const bool exists = distances.count({from, to}) != 0 || catalogue_ptr_->IsDistanceExist(from, to);
+        if (!exists || !removed_distances.insert({from, to}).second) {
+            throw std::out_of_range("Unknown distance from "s + from + " to "s + to);
+        }
+    }
+
+    for (const auto& i : base_requests) {
+        const auto& request = i.AsDict();
+        if (request.at("type"s).AsString() != "Stop"s || GetUpdateAction(request) != "remove"sv) {
+            continue;
+        }
+        const auto& name = UpdateString(request, "name"s);
+        check_stop(name);
+
+        bool is_used = std::any_of(buses.begin(), buses.end(), [&name](const auto& bus) {
+            return bus.second.has_value()
+                   && std::find(bus.second->first.begin(), bus.second->first.end(), name) != bus.second->first.end();
+        });
+        if (!is_used && catalogue_ptr_->IsStopExist(name)) {
+            for (std::string_view bus : catalogue_ptr_->SearchStop(name).route_names_at_stop) {
+                // Buses changed in the batch are counted above with their new stops
+                is_used = is_used || buses.count(std::string(bus)) == 0;
+            }
+        }
+        if (is_used) {
+            throw std::logic_error("Stop "s + name + " is used by buses"s);
+        }
+        stop_exists[name] = false;
+    }
+}
+
+bool JsonReader::UpdatesChangeRouter() const {
+
+    const auto& base_requests = all_objects_.GetRoot().AsDict().at("base_requests"s).AsArray();
+    ValidateUpdates(base_requests);
+
+    for (const auto& i : base_requests) {
+        const auto& request = i.AsDict();
+        const auto& type = request.at("type"s).AsString();
+        const auto action = GetUpdateAction(request);
 
-                catalogue_ptr_->CreateRouter(RouterSettings{routing_settings.at("bus_wait_time"s).AsDouble(),
-                                                            routing_settings.at("bus_velocity"s).AsDouble()});
+        // Every bus change replaces its edges, added and removed stops change the vertices
+        if (type == "Bus"s) {
+            return true;
+        }
+        if (type == "Stop"s && (action == "remove"sv || !catalogue_ptr_->IsStopExist(request.at("name"s).AsString()))) {
+            return true;
+        }
+        if (type == "Stop"s && request.count("road_distances"s) != 0) {
+            for (const auto& [to, distance] : request.at("road_distances"s).AsDict()) {
+                if (catalogue_ptr_->IsDistanceUsed(request.at("name"s).AsString(), to)) {
+                    return true;
+                }
             }
+        }
+        if (type == "Distance"s && catalogue_ptr_->IsDistanceUsed(request.at("from"s).AsString(),
+                                                                  request.at("to"s).AsString())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void JsonReader::ApplyUpdates(const json::Array& base_requests) {
+
+    // Nothing is applied unless the whole batch fits the catalogue
+    ValidateUpdates(base_requests);
+
+    // Stops are added or moved first, so buses and distances may use them
+    for (const auto& i : base_requests) {
+        const auto& request = i.AsDict();
+        if (request.at("type"s).AsString() != "Stop"s || GetUpdateAction(request) == "remove"sv) {
+            continue;
+        }
+        const auto& name = request.at("name"s).AsString();
+        const bool exists = catalogue_ptr_->IsStopExist(name);
+        if (exists && GetUpdateAction(request) == "add"sv) {
+            throw std::logic_error("Stop "s + name + " already exists"s);
+        }
+        if (!exists && GetUpdateAction(request) == "modify"sv) {
+            throw std::out_of_range("Unknown stop "s + name);
+        }
+        const Coordinates map_point{request.at("latitude"s).AsDouble(), request.at("longitude"s).AsDouble()};
+        exists ? catalogue_ptr_->UpdateStop(name, map_point) : catalogue_ptr_->AddStop(name, map_point);
+    }
+
+    for (const auto& i : base_requests) {
+        const auto& request = i.AsDict();
+        const auto& type = request.at("type"s).AsString();
+        if (GetUpdateAction(request) == "remove"sv) {
+            continue;
+        }
+        if (type == "Stop"s && request.count("road_distances"s) != 0) {
+            AddOneDistance(request);
+        }
+        if (type == "Distance"s) {
+            catalogue_ptr_->SetDistance(request.at("from"s).AsString(), request.at("to"s).AsString(),
+                                        request.at("distance"s).AsInt());
+        }
+    }
 
-            ProcessOptimalPathRequest(request);
+    for (const auto& i : base_requests) {
+        const auto& request = i.AsDict();
+        if (request.at("type"s).AsString() != "Bus"s) {
+            continue;
+        }
+        const auto& name = request.at("name"s).AsString();
+        const auto action = GetUpdateAction(request);
+
+        if (action == "remove"sv) {
+            catalogue_ptr_->RemoveRoute(name);
+            continue;
+        }
+
+        const bool exists = catalogue_ptr_->IsRouteExist(name);
+        if (exists && action == "add"sv) {
+            throw std::logic_error("Bus "s + name + " already exists"s);
+        }
+        if (!exists && action == "modify"sv) {
+            throw std::out_of_range("Unknown bus "s + name);
+        }
+        if (request.at("stops"s).AsArray().empty()) {
+            throw std::invalid_argument("Bus "s + name + " has no stops"s);
         }
 
+        const bool is_round = request.at("is_roundtrip"s).AsBool();
+        exists ? catalogue_ptr_->UpdateRoute(name, RouteStopNames(request), is_round)
+               : catalogue_ptr_->AddRoute(name, RouteStopNames(request), is_round);
+    }
 
-        if (request.at("type"s).AsString() == "Map"s) {
-            ProcessMapRequest(request);
+    for (const auto& i : base_requests) {
+        const auto& request = i.AsDict();
+        if (request.at("type"s).AsString() != "Timetable"s) {
+            continue;
+        }
+        if (GetUpdateAction(request) == "remove"sv) {
+            catalogue_ptr_->SetTimetable(request.at("bus"s).AsString(), {}, {});
+        } else {
+            AddOneTimetable(request);
         }
     }
+
+    // Distances and stops are removed last, when no bus uses them any more
+    for (const auto& i : base_requests) {
+        const auto& request = i.AsDict();
+        if (request.at("type"s).AsString() == "Distance"s && GetUpdateAction(request) == "remove"sv) {
+            catalogue_ptr_->RemoveDistance(request.at("from"s).AsString(), request.at("to"s).AsString());
+        }
+    }
+
+    for (const auto& i : base_requests) {
+        const auto& request = i.AsDict();
+        if (request.at("type"s).AsString() == "Stop"s && GetUpdateAction(request) == "remove"sv) {
+            catalogue_ptr_->RemoveStop(request.at("name"s).AsString());
+        }
+    }
+
+    catalogue_ptr_->SyncRouter();
+}
+
+void JsonReader::ProcessRequests() {
+    
+    const auto& root = all_objects_.GetRoot().AsDict();
+    const auto& stat_requests = root.at("stat_requests"s).AsArray();
+
+    bool group_routes = false;
+    if (auto it = root.find("processing_settings"s); it != root.end()) {
+        const auto& settings = it->second.AsDict();
+        group_routes = settings.count("group_routes_by_origin"s) != 0
+                       && settings.at("group_routes_by_origin"s).AsBool();
+    }
+
+    if (!group_routes) {
+        for (const auto& i : stat_requests) {
+            ProcessRequest(i.AsDict());
+        }
+        return;
+    }
+
+    // Updates split the requests into parts which are answered on the same catalogue. Within a part the
+    // Route requests take the slots of the Route requests grouped by origin, every other request stays
+    // in its place, so Stats still follows as many routes as before. The responses keep the input order.
+    size_t first = 0;
+    while (first < stat_requests.size()) {
+        size_t last = first;
+        while (last < stat_requests.size() && stat_requests[last].AsDict().at("type"s).AsString() != "Update"s) {
+            ++last;
+        }
+
+        auto is_route = [&stat_requests](size_t index) {
+            return stat_requests[index].AsDict().at("type"s).AsString() == "Route"s;
+        };
+
+        std::vector<size_t> routes;
+        for (size_t index = first; index < last; ++index) {
+            if (is_route(index)) {
+                routes.push_back(index);
+            }
+        }
+        std::stable_sort(routes.begin(), routes.end(), [&stat_requests](size_t lhs, size_t rhs) {
+            return stat_requests[lhs].AsDict().at("from"s).AsString()
+                   < stat_requests[rhs].AsDict().at("from"s).AsString();
+        });
+
+        // Responses of every request of the part, an unknown request has none
+        std::vector<Array> part(last - first);
+        auto next_route = routes.begin();
+        for (size_t slot = first; slot < last; ++slot) {
+            const size_t index = is_route(slot) ? *next_route++ : slot;
+            const size_t answered = responses_.size();
+            ProcessRequest(stat_requests[index].AsDict());
+            std::move(responses_.begin() + answered, responses_.end(), std::back_inserter(part[index - first]));
+            responses_.resize(answered);
+        }
+        for (auto& responses : part) {
+            std::move(responses.begin(), responses.end(), std::back_inserter(responses_));
+        }
+
+        if (last < stat_requests.size()) {
+            ProcessRequest(stat_requests[last].AsDict());
+        }
+        first = last + 1;
+    }
+}
+
+void JsonReader::ProcessRequest(const json::Dict& request) {
+
+    const auto& type = request.at("type"s).AsString();
+
+    profile::ScopedTimer timer("request."sv, type);
+    profile::ScopedLatency latency(type);
+
+    const auto capture_start = capture_ != nullptr ? query_log::Clock::now() : query_log::Clock::time_point{};
+
+    if (type == "Stop"s) {
+        ProcessStopRequest(request);
+    }
+
+    if (type == "Bus"s) {
+        ProcessRouteRequest(request);
+    }
+
+    if (type == "Route"s) {
+        EnsureRouter();
+        ProcessOptimalPathRequest(request);
+    }
+
+    if (type == "RouteOneToMany"s || type == "RouteMatrix"s) {
+        EnsureRouter();
+        ProcessTravelTimesRequest(request);
+    }
+
+    if (type == "ParetoRoute"s) {
+        EnsureRouter();
+        ProcessParetoPathRequest(request);
+    }
+
+    if (type == "AlternativeRoutes"s) {
+        EnsureRouter();
+        ProcessAlternativePathsRequest(request);
+    }
+
+    if (type == "Isochrone"s) {
+        EnsureRouter();
+        ProcessIsochroneRequest(request);
+    }
+
+    if (type == "RouteMap"s) {
+        EnsureRouter();
+        ProcessPathMapRequest(request);
+    }
+
+    if (type == "Map"s) {
+        ProcessMapRequest(request);
+    }
+
+    if (type == "Stats"s) {
+        ProcessStatsRequest(request);
+    }
+
+    if (type == "Update"s) {
+        ProcessUpdateRequest(request);
+    }
+
+    if (capture_ != nullptr) {
+        capture_->Record(request, capture_start, query_log::Clock::now());
+    }
+}
+
+void JsonReader::SetCapture(query_log::Capture* capture) {
+    capture_ = capture;
 }
 
 std::ostream& JsonReader::PrintResponses(std::ostream& output) {
@@ -72,6 +559,10 @@ std::ostream& JsonReader::PrintResponses(std::ostream& output) {
 
 }
 
+json::Array JsonReader::TakeResponses() {
+    return std::exchange(responses_, json::Array{});
+}
+
 const json::Document& JsonReader::GetJSONDocument() const {
     return all_objects_;
 }
@@ -99,6 +590,10 @@ void JsonReader::AddOneDistance(const Dict& request) {
     const auto& distances = request.at("road_distances"s).AsDict();
     for (const auto& name_to_distance : distances) {
 
+        // Distances to unknown stops are skipped like the buses through them
+        if (!catalogue_ptr_->IsStopExist(std::string_view(name_to_distance.first))) {
+            continue;
+        }
         catalogue_ptr_->SetDistance(request.at("name"s).AsString(),
                                     name_to_distance.first,
                                     name_to_distance.second.AsInt());
@@ -132,13 +627,19 @@ void JsonReader::AddOneRoute(const Dict& request) {
         }
     }
 
+    catalogue_ptr_->AddRoute(request.at("name"s).AsString(), RouteStopNames(request),
+                             request.at("is_roundtrip"s).AsBool());
+
+}
+
+std::vector<std::string> JsonReader::RouteStopNames(const Dict& request) {
+
     std::vector<std::string> stop_names;
 
     if (request.at("is_roundtrip"s).AsBool()) {
         for (const auto& j : request.at("stops"s).AsArray()) {
             stop_names.push_back(j.AsString());
         }
-        catalogue_ptr_->AddRoute(request.at("name"s).AsString(), stop_names, true);
     } else {
         for (int j = 0; j < static_cast<int>(request.at("stops"s).AsArray().size()); ++j) {
             stop_names.push_back(request.at("stops"s).AsArray()[j].AsString());
@@ -146,9 +647,9 @@ void JsonReader::AddOneRoute(const Dict& request) {
         for (int j = static_cast<int>(request.at("stops"s).AsArray().size()) -2; j >= 0 ; --j) {
             stop_names.push_back(request.at("stops"s).AsArray()[j].AsString());
         }
-        catalogue_ptr_->AddRoute(request.at("name"s).AsString(), stop_names, false);
     }
 
+    return stop_names;
 }
 
 void JsonReader::AddAllRoutes() {
@@ -165,6 +666,76 @@ void JsonReader::AddAllRoutes() {
     }
 }
 
+void JsonReader::AddOneTimetable(const Dict& request) {
+
+    auto to_numbers = [](const Node& node) {
+        std::vector<double> numbers;
+        numbers.reserve(node.AsArray().size());
+        for (const auto& number : node.AsArray()) {
+            numbers.push_back(number.AsDouble());
+        }
+        return numbers;
+    };
+
+    catalogue_ptr_->SetTimetable(request.at("bus"s).AsString(),
+                                 to_numbers(request.at("departures"s)),
+                                 request.count("run_times"s) != 0 ? to_numbers(request.at("run_times"s))
+                                                                  : std::vector<double>{});
+}
+
+void JsonReader::AddAllTimetables() {
+
+    const auto& base_requests = all_objects_.GetRoot().AsDict().at("base_requests"s).AsArray();
+
+    for (const auto& i : base_requests) {
+        const auto& request = i.AsDict();
+        // Buses skipped by AddOneRoute have no timetable either
+        if (request.at("type"s).AsString() == "Timetable"s
+            && catalogue_ptr_->IsRouteExist(request.at("bus"s).AsString())) {
+            AddOneTimetable(request);
+        }
+    }
+}
+
+void JsonReader::ProcessUpdateRequest(const Dict& request) {
+
+    try {
+        ApplyUpdates(request.at("base_requests"s).AsArray());
+    } catch (const std::exception& error) {
+        responses_.emplace_back(Builder{}
+                .StartDict()
+                    .Key("request_id"s).Value(Node(request.at("id"s)).GetValue())
+                    .Key("error_message"s).Value(std::string(error.what()))
+                .EndDict()
+                .Build());
+        return;
+    }
+
+    responses_.emplace_back(Builder{}
+            .StartDict()
+                .Key("request_id"s).Value(Node(request.at("id"s)).GetValue())
+            .EndDict()
+            .Build());
+}
+
+void JsonReader::ProcessStatsRequest(const Dict& request) {
+
+    // Latencies of the requests answered so far, the Stats request itself is not included yet
+    const auto cache = catalogue_ptr_->GetPathCacheStats();
+    responses_.emplace_back(Builder{}
+            .StartDict()
+                .Key("request_id"s).Value(Node(request.at("id"s)).GetValue())
+                .Key("latency_us"s).Value(profile::LatencyReport())
+                .Key("route_cache"s).StartDict()
+                    .Key("hits"s).Value(static_cast<int>(cache.hits))
+                    .Key("misses"s).Value(static_cast<int>(cache.misses))
+                    .Key("size"s).Value(static_cast<int>(cache.size))
+                    .Key("capacity"s).Value(static_cast<int>(cache.capacity))
+                .EndDict()
+            .EndDict()
+            .Build());
+}
+
 void JsonReader::ProcessStopRequest(const Dict& request) {
 
     auto response = catalogue_ptr_->SearchStop(request.at("name"s).AsString());
@@ -223,40 +794,59 @@ void JsonReader::ProcessRouteRequest(const Dict& request) {
 
 }
 
-void JsonReader::ProcessOptimalPathRequest(const json::Dict& request) {
+void JsonReader::EnsureRouter() {
+    if (!catalogue_ptr_->RouterExist()) {
+        const auto& routing_settings = all_objects_.GetRoot().AsDict().at("routing_settings"s).AsDict();
 
-    auto response =
-            catalogue_ptr_->SearchOptimalPath(request.at("from"s).AsString(),
-                                              request.at("to"s).AsString());
+        catalogue_ptr_->CreateRouter(RouterSettings{routing_settings.at("bus_wait_time"s).AsDouble(),
+                                                    routing_settings.at("bus_velocity"s).AsDouble()});
+    }
+}
 
-    if (response.is_found) {
+json::Array JsonReader::BuildPathItems(const OptimalPathSearchResponse& response) {
 
-        Array items;
+    Array items;
 
-        for (const auto& i : response.items) {
-            if (i.type == "Wait") {
-                Node wait_item = Builder{}.StartDict()
+    for (const auto& i : response.items) {
+        if (i.type == "Wait") {
+            Node wait_item = Builder{}.StartDict()
+                .Key("type"s).Value(std::string(i.type))
+                .Key("stop_name"s).Value(std::string(i.name))
+                .Key("time"s).Value(i.time)
+                .EndDict().Build();
+            items.emplace_back(wait_item);
+        } else {
+            Node ride_item = Builder{}.StartDict()
                     .Key("type"s).Value(std::string(i.type))
-                    .Key("stop_name"s).Value(std::string(i.name))
+                    .Key("bus"s).Value(std::string(i.name))
+                    .Key("span_count"s).Value(i.span_count)
                     .Key("time"s).Value(i.time)
                     .EndDict().Build();
-                items.emplace_back(wait_item);
-            } else {
-                Node ride_item = Builder{}.StartDict()
-                        .Key("type"s).Value(std::string(i.type))
-                        .Key("bus"s).Value(std::string(i.name))
-                        .Key("span_count"s).Value(i.span_count)
-                        .Key("time"s).Value(i.time)
-                        .EndDict().Build();
-                items.emplace_back(ride_item);
-            }
+            items.emplace_back(ride_item);
         }
+    }
+
+    return items;
+}
+
+void JsonReader::ProcessOptimalPathRequest(const json::Dict& request) {
+
+    if (request.count("departure_time"s) != 0) {
+        ProcessTimetablePathRequest(request);
+        return;
+    }
+
+    auto response =
+            catalogue_ptr_->SearchOptimalPath(request.at("from"s).AsString(),
+                                              request.at("to"s).AsString());
+
+    if (response.is_found) {
 
         responses_.emplace_back(Builder{}
                                      .StartDict()
                                      .Key("request_id"s).Value(Node(request.at("id"s)).GetValue())
                                      .Key("total_time"s).Value(response.total_time)
-                                     .Key("items"s).Value(items)
+                                     .Key("items"s).Value(BuildPathItems(response))
                                      .EndDict().Build());
 
         return;
@@ -272,6 +862,230 @@ void JsonReader::ProcessOptimalPathRequest(const json::Dict& request) {
 
 }
 
+void JsonReader::ProcessTimetablePathRequest(const json::Dict& request) {
+
+    const double departure_time = request.at("departure_time"s).AsDouble();
+    auto response = catalogue_ptr_->SearchTimetablePath(request.at("from"s).AsString(),
+                                                        request.at("to"s).AsString(),
+                                                        departure_time);
+
+    if (!response.is_found) {
+        responses_.emplace_back(Builder{}
+                                        .StartDict()
+                                        .Key("request_id"s).Value(Node(request.at("id"s)).GetValue())
+                                        .Key("error_message"s).Value(Node("not found"s).GetValue())
+                                        .EndDict().Build());
+        return;
+    }
+
+    responses_.emplace_back(Builder{}
+                                    .StartDict()
+                                    .Key("request_id"s).Value(Node(request.at("id"s)).GetValue())
+                                    .Key("total_time"s).Value(response.total_time)
+                                    .Key("arrival_time"s).Value(departure_time + response.total_time)
+                                    .Key("items"s).Value(BuildPathItems(response))
+                                    .EndDict().Build());
+}
+
+void JsonReader::ProcessTravelTimesRequest(const json::Dict& request) {
+
+    const bool is_matrix = request.at("type"s).AsString() == "RouteMatrix"s;
+
+    auto to_names = [](const Node& node) {
+        std::vector<std::string> names;
+        for (const auto& name : node.AsArray()) {
+            names.push_back(name.AsString());
+        }
+        return names;
+    };
+
+    const auto from = is_matrix ? to_names(request.at("from"s)) : std::vector{request.at("from"s).AsString()};
+    auto response = catalogue_ptr_->SearchTravelTimes(from, to_names(request.at("to"s)));
+
+    if (!response.is_found) {
+        responses_.emplace_back(Builder{}
+                                        .StartDict()
+                                        .Key("request_id"s).Value(Node(request.at("id"s)).GetValue())
+                                        .Key("error_message"s).Value(Node("not found"s).GetValue())
+                                        .EndDict().Build());
+        return;
+    }
+
+    Array rows;
+    rows.reserve(response.times.size());
+    for (const auto& row : response.times) {
+        Array times;
+        times.reserve(row.size());
+        for (const auto& time : row) {
+            times.emplace_back(time ? Node(*time) : Node());
+        }
+        rows.emplace_back(std::move(times));
+    }
+
+    responses_.emplace_back(Builder{}
+                                    .StartDict()
+                                    .Key("request_id"s).Value(Node(request.at("id"s)).GetValue())
+                                    .Key("total_time"s).Value(is_matrix ? Node(std::move(rows)).GetValue() : rows.front().GetValue())
+                                    .EndDict().Build());
+}
+
+void JsonReader::ProcessParetoPathRequest(const json::Dict& request) {
+
+    const int max_transfers = request.count("max_transfers"s) != 0 ? request.at("max_transfers"s).AsInt() : 3;
+
+    auto response = catalogue_ptr_->SearchParetoPaths(request.at("from"s).AsString(),
+                                                      request.at("to"s).AsString(),
+                                                      max_transfers);
+
+    if (!response.is_found) {
+        responses_.emplace_back(Builder{}
+                                        .StartDict()
+                                        .Key("request_id"s).Value(Node(request.at("id"s)).GetValue())
+                                        .Key("error_message"s).Value(Node("not found"s).GetValue())
+                                        .EndDict().Build());
+        return;
+    }
+
+    Array routes;
+    for (const auto& option : response.options) {
+        const int rides = static_cast<int>(option.items.size() / 2);
+        routes.emplace_back(Builder{}.StartDict()
+                                    .Key("transfers"s).Value(std::max(rides - 1, 0))
+                                    .Key("total_time"s).Value(option.total_time)
+                                    .Key("items"s).Value(BuildPathItems(option))
+                                    .EndDict().Build());
+    }
+
+    responses_.emplace_back(Builder{}
+                                    .StartDict()
+                                    .Key("request_id"s).Value(Node(request.at("id"s)).GetValue())
+                                    .Key("routes"s).Value(std::move(routes))
+                                    .EndDict().Build());
+}
+
+void JsonReader::ProcessAlternativePathsRequest(const json::Dict& request) {
+
+    const int count = request.count("count"s) != 0 ? request.at("count"s).AsInt() : 3;
+
+    auto response = catalogue_ptr_->SearchAlternativePaths(request.at("from"s).AsString(),
+                                                           request.at("to"s).AsString(),
+                                                           count);
+
+    if (!response.is_found) {
+        responses_.emplace_back(Builder{}
+                                        .StartDict()
+                                        .Key("request_id"s).Value(Node(request.at("id"s)).GetValue())
+                                        .Key("error_message"s).Value(Node("not found"s).GetValue())
+                                        .EndDict().Build());
+        return;
+    }
+
+    Array routes;
+    for (const auto& option : response.options) {
+        routes.emplace_back(Builder{}.StartDict()
+                                    .Key("total_time"s).Value(option.total_time)
+                                    .Key("items"s).Value(BuildPathItems(option))
+                                    .EndDict().Build());
+    }
+
+    responses_.emplace_back(Builder{}
+                                    .StartDict()
+                                    .Key("request_id"s).Value(Node(request.at("id"s)).GetValue())
+                                    .Key("routes"s).Value(std::move(routes))
+                                    .EndDict().Build());
+}
+
+void JsonReader::ProcessIsochroneRequest(const json::Dict& request) {
+
+    auto response = catalogue_ptr_->SearchReachableStops(request.at("from"s).AsString(),
+                                                         request.at("max_time"s).AsDouble());
+
+    if (!response.is_found) {
+        responses_.emplace_back(Builder{}
+                                        .StartDict()
+                                        .Key("request_id"s).Value(Node(request.at("id"s)).GetValue())
+                                        .Key("error_message"s).Value(Node("not found"s).GetValue())
+                                        .EndDict().Build());
+        return;
+    }
+
+    Array items;
+    items.reserve(response.stops.size());
+    for (const auto& [stop_ptr, time] : response.stops) {
+        items.emplace_back(Builder{}.StartDict()
+                                   .Key("stop_name"s).Value(stop_ptr->name)
+                                   .Key("time"s).Value(time)
+                                   .EndDict().Build());
+    }
+
+    responses_.emplace_back(Builder{}
+                                    .StartDict()
+                                    .Key("request_id"s).Value(Node(request.at("id"s)).GetValue())
+                                    .Key("items"s).Value(std::move(items))
+                                    .EndDict().Build());
+}
+
+void JsonReader::ProcessPathMapRequest(const json::Dict& request) {
+
+    if (!renderer_.has_value()) {
+        renderer_ = MapRenderer(catalogue_ptr_);
+    }
+
+    auto response =
+            catalogue_ptr_->SearchOptimalPath(request.at("from"s).AsString(),
+                                              request.at("to"s).AsString());
+
+    // Optional "format" works the same way as for Map requests
+    std::optional<raster::Format> format;
+    if (request.count("format"s) != 0 && request.at("format"s).AsString() != "svg"s) {
+        format = raster::ParseFormat(request.at("format"s).AsString());
+        if (!format) {
+            responses_.emplace_back(Builder{}
+                                            .StartDict()
+                                            .Key("request_id"s).Value(Node(request.at("id"s)).GetValue())
+                                            .Key("error_message"s).Value("unknown format"s)
+                                            .EndDict().Build());
+            return;
+        }
+        if (!renderer_.value().IsRasterSizeSupported()) {
+            responses_.emplace_back(Builder{}
+                                            .StartDict()
+                                            .Key("request_id"s).Value(Node(request.at("id"s)).GetValue())
+                                            .Key("error_message"s).Value("image too large"s)
+                                            .EndDict().Build());
+            return;
+        }
+    }
+
+    if (!response.is_found) {
+        responses_.emplace_back(Builder{}
+                                        .StartDict()
+                                        .Key("request_id"s).Value(Node(request.at("id"s)).GetValue())
+                                        .Key("error_message"s).Value("not found"s)
+                                        .EndDict().Build());
+        return;
+    }
+
+    std::stringstream output;
+    std::string map_as_string;
+
+    if (format) {
+        renderer_.value().GetPathRasterMap(output, response, *format);
+        map_as_string = raster::EncodeBase64(output.str());
+    } else {
+        renderer_.value().GetPathMap(output, response);
+        map_as_string = output.str();
+    }
+
+    responses_.emplace_back(Builder{}
+                                    .StartDict()
+                                    .Key("request_id"s).Value(Node(request.at("id"s)).GetValue())
+                                    .Key("total_time"s).Value(response.total_time)
+                                    .Key("items"s).Value(BuildPathItems(response))
+                                    .Key("map"s).Value(std::move(map_as_string))
+                                    .EndDict().Build());
+}
+
 void JsonReader::ProcessMapRequest(const Dict& request) {
 
     using namespace renderer;
@@ -282,6 +1096,39 @@ void JsonReader::ProcessMapRequest(const Dict& request) {
 
     std::stringstream output;
 
+    // Optional "format": "svg" (default), "png" or "ppm". Bitmaps are returned base64 encoded.
+    if (request.count("format"s) != 0 && request.at("format"s).AsString() != "svg"s) {
+
+        auto format = raster::ParseFormat(request.at("format"s).AsString());
+
+        if (!format) {
+            responses_.emplace_back(Builder{}
+                                            .StartDict()
+                                            .Key("request_id"s).Value(Node(request.at("id"s)).GetValue())
+                                            .Key("error_message"s).Value("unknown format"s)
+                                            .EndDict().Build());
+            return;
+        }
+        if (!renderer_.value().IsRasterSizeSupported()) {
+            responses_.emplace_back(Builder{}
+                                            .StartDict()
+                                            .Key("request_id"s).Value(Node(request.at("id"s)).GetValue())
+                                            .Key("error_message"s).Value("image too large"s)
+                                            .EndDict().Build());
+            return;
+        }
+
+        renderer_.value().GetCompleteRasterMap(output, *format);
+
+        responses_.emplace_back(Builder{}
+                                        .StartDict()
+                                        .Key("format"s).Value(request.at("format"s).AsString())
+                                        .Key("map"s).Value(raster::EncodeBase64(output.str()))
+                                        .Key("request_id"s).Value(Node(request.at("id"s)).GetValue())
+                                        .EndDict().Build());
+        return;
+    }
+
     renderer_.value().GetCompleteMap(output);
 
     std::string map_as_string = output.str();
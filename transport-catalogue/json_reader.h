@@ -9,6 +9,7 @@
 #include "transport_catalogue.h"
 #include "geo.h"
 #include "map_renderer.h"
+#include "query_log.h"
 
 using namespace domain;
 using namespace renderer;
@@ -23,18 +24,44 @@ std::istream& ReadJSON(std::istream& input);
 const json::Document& GetJSONDocument() const;
     
 void FillCatalogue();
-    
+
+// Applies base_requests as changes to a catalogue loaded from a base. Every request may have
+// "action": "add", "modify" or "remove", without it a stop or a bus is added or replaced.
+// Besides Stop and Bus there are {"type": "Distance", "from", "to", "distance"} requests
+// and Timetable ones (see AddOneTimetable), a removed timetable needs only "bus".
+// The whole batch is checked first: if one change does not fit the catalogue, none is applied.
+// throws std::logic_error (std::out_of_range, std::invalid_argument) naming the change which does not fit
+void ApplyUpdates();
+
+// Whether ApplyUpdates() may change the router graph. Moved stops and timetables do not, nor do
+// distances which no bus rides, so a base can be updated without decoding its router.
+// throws like ApplyUpdates() if the changes do not fit the catalogue
+bool UpdatesChangeRouter() const;
+
+// With "processing_settings": {"group_routes_by_origin": true} the Route requests between two updates
+// are answered grouped by their origin, so they reuse the shortest path trees of the router.
+// The responses are in the order of the requests anyway.
 void ProcessRequests();
 
+// Answers one element of stat_requests, the response is appended to the others
+void ProcessRequest(const json::Dict& request);
+
 std::ostream& PrintResponses(std::ostream& output);
 
+// Responses collected so far, the reader keeps none of them
+json::Array TakeResponses();
+
 void SetRenderSettings(Settings&& settings);
+
+// Every processed stat request is recorded with its timing, nullptr stops the capture
+void SetCapture(query_log::Capture* capture);
     
 private:
     json::Document all_objects_ = json::Document(json::Node());
     transport_catalogue::TransportCatalogue* catalogue_ptr_ = nullptr;
     json::Array responses_;
     std::optional<MapRenderer> renderer_ = std::nullopt;
+    query_log::Capture* capture_ = nullptr;
 
     void AddOneStop(const json::Dict& request);
     void AddAllStops();
@@ -45,11 +72,61 @@ private:
     void AddOneRoute(const json::Dict& request);
     void AddAllRoutes();
 
+    // {"type": "Timetable", "bus", "departures": [minutes after midnight], "run_times": [minutes]},
+    // run_times between neighbouring stops are optional
+    void AddOneTimetable(const json::Dict& request);
+    void AddAllTimetables();
+
+    // Stops of a Bus request, a non-round route is expanded to the way there and back
+    static std::vector<std::string> RouteStopNames(const json::Dict& request);
+
+    // Empty if the request has no action
+    static std::string_view GetUpdateAction(const json::Dict& request);
+
     void ProcessStopRequest(const json::Dict& request);
     void ProcessRouteRequest(const json::Dict& request);
     void ProcessMapRequest(const json::Dict& request);
 
+    // Latency percentiles by request type, see profile::LatencyReport()
+    void ProcessStatsRequest(const json::Dict& request);
+
+    // Live edit: {"type": "Update", "id", "base_requests": [...]} in the format of ApplyUpdates().
+    // A batch which does not fit the catalogue changes nothing, the failure is reported in error_message.
+    void ProcessUpdateRequest(const json::Dict& request);
+
+    void ApplyUpdates(const json::Array& base_requests);
+
+    // throws like ApplyUpdates() if the batch does not fit the catalogue, changes nothing
+    void ValidateUpdates(const json::Array& base_requests) const;
+
     void ProcessOptimalPathRequest(const json::Dict& request);
+
+    // Route request with "departure_time" (minutes after midnight), answered by the timetables.
+    // Besides "total_time" and "items" it has "arrival_time"
+    void ProcessTimetablePathRequest(const json::Dict& request);
+
+    // {"type": "RouteOneToMany", "from": stop, "to": [stops]} answers "total_time": [times],
+    // {"type": "RouteMatrix", "from": [stops], "to": [stops]} answers "total_time": [[times]].
+    // Unreachable stops get null.
+    void ProcessTravelTimesRequest(const json::Dict& request);
+
+    // {"type": "ParetoRoute", "from", "to", "max_transfers"} answers "routes": [{"transfers", "total_time", "items"}],
+    // the journeys which are best either in time or in transfers, max_transfers is 3 by default
+    void ProcessParetoPathRequest(const json::Dict& request);
+
+    // {"type": "AlternativeRoutes", "from", "to", "count"} answers "routes": [{"total_time", "items"}],
+    // the fastest path and up to count - 1 alternatives on other buses, count is 3 by default
+    void ProcessAlternativePathsRequest(const json::Dict& request);
+
+    // {"type": "Isochrone", "from": stop, "max_time": minutes} answers "items": [{"stop_name", "time"}],
+    // the nearest stops first
+    void ProcessIsochroneRequest(const json::Dict& request);
+    void ProcessPathMapRequest(const json::Dict& request);
+
+    // Lazy Initialization. Heavy graph will be created only if a path request is called.
+    void EnsureRouter();
+
+    static json::Array BuildPathItems(const transport_catalogue::OptimalPathSearchResponse& response);
     void SetRoutingSettings(const json::Dict& routing_settings) const;
 };
 
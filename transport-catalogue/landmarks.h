@@ -0,0 +1,167 @@
+#pragma once
+
+#include "graph.h"
+#include "shortest_path_tree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Lower bounds of the distances by the triangle inequality over a few landmark vertices (ALT).
+// With d(L, v) and d(v, L) known for every vertex v, the distance from v to t is at least
+// d(L, t) - d(L, v) and d(v, L) - d(t, L). The bounds make a consistent potential for A*.
+// Distances are kept as floats, vertex-major: all landmarks of a vertex are next to each other.
+template <typename Weight>
+class LandmarkBounds {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    LandmarkBounds() = default;
+
+    // forward[vertex * landmark count + index] is the distance from the landmark to the vertex,
+    // backward the distance from the vertex to the landmark, infinity if there is no path
+    LandmarkBounds(std::vector<VertexId> landmarks, std::vector<float> forward, std::vector<float> backward)
+        : landmarks_(std::move(landmarks)), forward_(std::move(forward)), backward_(std::move(backward))
+    {
+    }
+
+    // Picks up to count landmarks, every next one as far as possible from the ones picked before,
+    // and computes their distances by searches on the graph and on the reversed graph
+    static LandmarkBounds Select(const Graph& graph, size_t count);
+
+    // Vertices beyond the ones the distances were computed for get no bounds
+    bool IsValid(size_t vertex_count) const {
+        return !landmarks_.empty() && forward_.size() == vertex_count * landmarks_.size()
+               && backward_.size() == forward_.size();
+    }
+
+    Weight GetLowerBound(VertexId vertex, VertexId target) const;
+
+    const std::vector<VertexId>& GetLandmarks() const {
+        return landmarks_;
+    }
+
+    const std::vector<float>& GetForward() const {
+        return forward_;
+    }
+
+    const std::vector<float>& GetBackward() const {
+        return backward_;
+    }
+
+private:
+    std::vector<VertexId> landmarks_;
+    std::vector<float> forward_;
+    std::vector<float> backward_;
+};
+
+template <typename Weight>
+LandmarkBounds<Weight> LandmarkBounds<Weight>::Select(const Graph& graph, size_t count) {
+
+    const size_t vertex_count = graph.GetVertexCount();
+    const float infinity = std::numeric_limits<float>::infinity();
+
+    Graph reversed(vertex_count);
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+            const auto& edge = graph.GetEdge(edge_id);
+            reversed.AddEdge(Edge<Weight>{edge.to, edge.from, edge.weight});
+        }
+    }
+
+    ShortestPathTree<Weight> forward_tree(graph);
+    ShortestPathTree<Weight> backward_tree(reversed);
+
+    // The first landmark is the farthest vertex from the first one with edges
+    auto first = std::find_if(graph.GetIncidenceListsRef().begin(), graph.GetIncidenceListsRef().end(),
+                              [](const auto& list) { return !list.empty(); });
+    if (first == graph.GetIncidenceListsRef().end() || count == 0) {
+        return {};
+    }
+    forward_tree.Build(VertexId(first - graph.GetIncidenceListsRef().begin()));
+    VertexId next = forward_tree.GetSettledVertices().back();
+
+    std::vector<VertexId> landmarks;
+    std::vector<std::vector<float>> forward;
+    std::vector<std::vector<float>> backward;
+
+    // Distance of every vertex to the nearest landmark picked so far
+    std::vector<Weight> nearest(vertex_count, std::numeric_limits<Weight>::max());
+
+    while (landmarks.size() < count) {
+        landmarks.push_back(next);
+        forward_tree.Build(next);
+        backward_tree.Build(next);
+
+        auto& to_vertices = forward.emplace_back(vertex_count, infinity);
+        auto& from_vertices = backward.emplace_back(vertex_count, infinity);
+        for (const VertexId vertex : forward_tree.GetSettledVertices()) {
+            to_vertices[vertex] = static_cast<float>(forward_tree.GetWeight(vertex));
+            nearest[vertex] = std::min(nearest[vertex], forward_tree.GetWeight(vertex));
+        }
+        for (const VertexId vertex : backward_tree.GetSettledVertices()) {
+            from_vertices[vertex] = static_cast<float>(backward_tree.GetWeight(vertex));
+        }
+
+        // Vertices no landmark reaches stay at the maximum and are not picked
+        Weight farthest{};
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            if (nearest[vertex] != std::numeric_limits<Weight>::max() && nearest[vertex] > farthest) {
+                farthest = nearest[vertex];
+                next = vertex;
+            }
+        }
+        if (farthest == Weight{}) {
+            break;
+        }
+    }
+
+    std::vector<float> forward_flat(vertex_count * landmarks.size());
+    std::vector<float> backward_flat(vertex_count * landmarks.size());
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        for (size_t index = 0; index < landmarks.size(); ++index) {
+            forward_flat[vertex * landmarks.size() + index] = forward[index][vertex];
+            backward_flat[vertex * landmarks.size() + index] = backward[index][vertex];
+        }
+    }
+
+    return LandmarkBounds(std::move(landmarks), std::move(forward_flat), std::move(backward_flat));
+}
+
+template <typename Weight>
+Weight LandmarkBounds<Weight>::GetLowerBound(VertexId vertex, VertexId target) const {
+
+    // Rounding to floats may overstate a difference, it is taken off so the bound stays below the distance
+    static const double ROUNDING = std::numeric_limits<float>::epsilon();
+
+    const size_t count = landmarks_.size();
+    const float* vertex_forward = forward_.data() + vertex * count;
+    const float* target_forward = forward_.data() + target * count;
+    const float* vertex_backward = backward_.data() + vertex * count;
+    const float* target_backward = backward_.data() + target * count;
+
+    double bound = 0.0;
+    for (size_t index = 0; index < count; ++index) {
+        const double to_target = target_forward[index];
+        const double to_vertex = vertex_forward[index];
+        if (std::isfinite(to_target) && std::isfinite(to_vertex)) {
+            bound = std::max(bound, to_target - to_vertex - ROUNDING * (to_target + to_vertex));
+        }
+
+        const double from_vertex = vertex_backward[index];
+        const double from_target = target_backward[index];
+        if (std::isfinite(from_vertex) && std::isfinite(from_target)) {
+            bound = std::max(bound, from_vertex - from_target - ROUNDING * (from_vertex + from_target));
+        }
+    }
+
+    return static_cast<Weight>(bound);
+}
+
+} // namespace graph
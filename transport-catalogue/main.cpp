@@ -1,35 +1,104 @@
-
+#include <fstream>
 #include <iostream>
+#include <string>
 #include <string_view>
 
+#include "profile.h"
 #include "serialization.h"
+#include "snapshot.h"
 
 using namespace std::literals;
 
 void PrintUsage(std::ostream& stream = std::cerr) {
-    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+    stream << "Usage: transport_catalogue [make_base|update_base|process_requests|serve] [--profile[=FILE]] [--capture=FILE]\n"sv
+           << "The profiling report can also be requested with TC_PROFILE=stderr|FILE\n"sv;
+}
+
+// Returns true and the value of "--name=value" if the option matches
+bool ParseOption(std::string_view option, std::string_view name, std::string& value) {
+    if (option.substr(0, name.size()) != name || option.size() <= name.size() || option[name.size()] != '=') {
+        return false;
+    }
+    value = std::string(option.substr(name.size() + 1));
+    return true;
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
+    if (argc < 2) {
         PrintUsage();
         return 1;
     }
 
     const std::string_view mode(argv[1]);
 
+    // --profile writes the report to stderr, --profile=FILE to the file
+    std::string profile_sink;
+    const char* sink = profile::SinkFromEnvironment();
+
+    // --capture=FILE records stat_requests with their timing for benchmark/query_replay
+    std::string capture_file;
+
+    for (int index = 2; index < argc; ++index) {
+        const std::string_view option(argv[index]);
+        if (option == "--profile"sv) {
+            profile_sink = "stderr"s;
+            sink = profile_sink.c_str();
+        } else if (ParseOption(option, "--profile"sv, profile_sink)) {
+            sink = profile_sink.c_str();
+        } else if (ParseOption(option, "--capture"sv, capture_file) && mode == "process_requests"sv) {
+            continue;
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    profile::Session profile_session(sink);
+
     if (mode == "make_base"sv) {
 
         // make base here
-        serial_database::MakeBase(std::cin);
+        profile::CountingBuffer input(std::cin.rdbuf(), "io.json_bytes_read"s);
+        std::istream counted_input(profile::IsEnabled() ? &input : std::cin.rdbuf());
+        serial_database::MakeBase(counted_input);
+
+    } else if (mode == "update_base"sv) {
+
+        profile::CountingBuffer input(std::cin.rdbuf(), "io.json_bytes_read"s);
+        std::istream counted_input(profile::IsEnabled() ? &input : std::cin.rdbuf());
+        if (!serial_database::UpdateBase(counted_input)) {
+            return 1;
+        }
 
     } else if (mode == "process_requests"sv) {
 
+        std::ofstream capture_output;
+        if (!capture_file.empty()) {
+            capture_output.open(capture_file);
+            if (!capture_output) {
+                std::cerr << "Unable to open capture file "sv << capture_file << std::endl;
+                return 1;
+            }
+        }
+
         // process requests here
-        serial_database::ProcessRequests(std::cin, std::cout);
+        profile::CountingBuffer input(std::cin.rdbuf(), "io.json_bytes_read"s);
+        profile::CountingBuffer output(std::cout.rdbuf(), "io.json_bytes_written"s);
+        std::istream counted_input(profile::IsEnabled() ? &input : std::cin.rdbuf());
+        std::ostream counted_output(profile::IsEnabled() ? &output : std::cout.rdbuf());
+        serial_database::ProcessRequests(counted_input, counted_output,
+                                         capture_file.empty() ? nullptr : &capture_output);
+        counted_output.flush();
+
+    } else if (mode == "serve"sv) {
+
+        // answers requests until the input ends, Reload switches the base in the background
+        if (!serial_database::Serve(std::cin, std::cout)) {
+            return 1;
+        }
 
     } else {
         PrintUsage();
         return 1;
     }
-}
\ No newline at end of file
+}
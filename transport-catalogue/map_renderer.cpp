@@ -1,5 +1,10 @@
 #include "map_renderer.h"
+#include "profile.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <future>
 #include <string>
 #include <vector>
 
@@ -34,7 +39,125 @@ void MapRenderer::CreateSphereProjector() {
 
 }
 
-void MapRenderer::RenderRoutes() {
+void MapRenderer::CullStops() {
+
+    assert(projector_);
+
+    culled_stops_.clear();
+
+    const double tolerance = settings_.simplification_tolerance;
+    if (tolerance <= 0) {
+        return;
+    }
+
+    // Kept stops are bucketed into a grid with cell size equal to tolerance,
+    // so a candidate has to be compared only with the 3x3 neighbouring cells.
+    auto cell_of = [tolerance](svg::Point point) {
+        return std::pair<int64_t, int64_t>{static_cast<int64_t>(std::floor(point.x / tolerance)),
+                                           static_cast<int64_t>(std::floor(point.y / tolerance))};
+    };
+
+    std::map<std::pair<int64_t, int64_t>, std::vector<svg::Point>> kept;
+
+    for (const auto& name_to_stop_ptr : all_stops_in_routes_) {
+
+        auto point = Projected(name_to_stop_ptr.second);
+        auto [cell_x, cell_y] = cell_of(point);
+
+        bool is_hidden = false;
+        for (int64_t dx = -1; dx <= 1 && !is_hidden; ++dx) {
+            for (int64_t dy = -1; dy <= 1 && !is_hidden; ++dy) {
+                auto it = kept.find({cell_x + dx, cell_y + dy});
+                if (it == kept.end()) {
+                    continue;
+                }
+                for (const auto& other : it->second) {
+                    if (IsCloser(point, other, tolerance)) {
+                        is_hidden = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (is_hidden) {
+            culled_stops_.insert(name_to_stop_ptr.second);
+        } else {
+            kept[{cell_x, cell_y}].push_back(point);
+        }
+    }
+}
+
+std::vector<svg::Point> MapRenderer::SimplifyPolyline(const std::vector<svg::Point>& points, double tolerance) {
+
+    if (points.size() < 3) {
+        return points;
+    }
+
+    std::vector<bool> keep(points.size(), false);
+    keep.front() = true;
+    keep.back() = true;
+
+    // Iterative Douglas-Peucker: the stack holds [first, last] index ranges still to be examined
+    std::vector<std::pair<size_t, size_t>> ranges{{0, points.size() - 1}};
+
+    while (!ranges.empty()) {
+        auto [first, last] = ranges.back();
+        ranges.pop_back();
+
+        const svg::Point a = points[first];
+        const svg::Point b = points[last];
+        const double dx = b.x - a.x;
+        const double dy = b.y - a.y;
+        const double length_sq = dx * dx + dy * dy;
+
+        double max_dist_sq = 0;
+        size_t farthest = first;
+
+        for (size_t i = first + 1; i < last; ++i) {
+            double px = points[i].x - a.x;
+            double py = points[i].y - a.y;
+            double dist_sq;
+
+            if (length_sq == 0) {
+                // Closed segment (round trip), distance to the point itself
+                dist_sq = px * px + py * py;
+            } else {
+                double t = std::clamp((px * dx + py * dy) / length_sq, 0.0, 1.0);
+                double ex = px - t * dx;
+                double ey = py - t * dy;
+                dist_sq = ex * ex + ey * ey;
+            }
+
+            if (dist_sq > max_dist_sq) {
+                max_dist_sq = dist_sq;
+                farthest = i;
+            }
+        }
+
+        if (max_dist_sq > tolerance * tolerance) {
+            keep[farthest] = true;
+            ranges.emplace_back(first, farthest);
+            ranges.emplace_back(farthest, last);
+        }
+    }
+
+    std::vector<svg::Point> result;
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (keep[i]) {
+            result.push_back(points[i]);
+        }
+    }
+    return result;
+}
+
+bool MapRenderer::IsCloser(svg::Point lhs, svg::Point rhs, double tolerance) {
+    const double dx = lhs.x - rhs.x;
+    const double dy = lhs.y - rhs.y;
+    return dx * dx + dy * dy < tolerance * tolerance;
+}
+
+void MapRenderer::RenderRoutes(svg::ObjectContainer& container) {
 
     assert(projector_);
 
@@ -52,23 +175,34 @@ void MapRenderer::RenderRoutes() {
                         SetStrokeWidth(settings_.line_width).
                         SetStrokeLineCap(svg::StrokeLineCap::ROUND).
                         SetStrokeLineJoin(svg::StrokeLineJoin::ROUND).
-                        SetStrokeColor(settings_.color_palette[color_counter]);
+                        SetStrokeColor(GetPaletteColor(color_counter));
 
         ++color_counter;
         if (color_counter == static_cast<int>(settings_.color_palette.size())) {
             color_counter = 0;
         }
 
+        std::vector<svg::Point> points;
+        points.reserve(name_to_route_ptr.second->stops.size());
+
         for (const auto& stop_ptr : name_to_route_ptr.second->stops) {
-            route_map_line.AddPoint(projector_.value()(stop_ptr->map_point));
+            points.push_back(Projected(stop_ptr));
         }
 
-        picture_.Add(route_map_line);
+        if (settings_.simplification_tolerance > 0) {
+            points = SimplifyPolyline(points, settings_.simplification_tolerance);
+        }
+
+        for (const auto& point : points) {
+            route_map_line.AddPoint(point);
+        }
+
+        container.Add(route_map_line);
 
     }
 }
 
-void MapRenderer::RenderRoutesNames() {
+void MapRenderer::RenderRoutesNames(svg::ObjectContainer& container) {
 
     assert(projector_);
 
@@ -80,30 +214,31 @@ void MapRenderer::RenderRoutesNames() {
             continue;
         }
 
-        auto first_stop = projector_.value()(name_to_route_ptr.second->stops.at(0)->map_point);
+        auto first_stop = Projected(name_to_route_ptr.second->stops.at(0));
 
-        picture_.Add(RouteUnderlinerPrintTemplate(settings_)
+        container.Add(RouteUnderlinerPrintTemplate(settings_)
                 .SetPosition(first_stop)
                 .SetData(name_to_route_ptr.first));
 
-        picture_.Add(RoutePrintTemplate(settings_)
+        container.Add(RoutePrintTemplate(settings_)
                 .SetPosition(first_stop)
-                .SetFillColor(settings_.color_palette[color_counter])
+                .SetFillColor(GetPaletteColor(color_counter))
                 .SetData(name_to_route_ptr.first));
 
         if (!name_to_route_ptr.second->is_roundtrip) {
 
-            auto end_stop = projector_.value()(name_to_route_ptr.second->stops.at(static_cast<int>(name_to_route_ptr.second->stops.size())/2)->map_point);
+            auto end_stop = Projected(name_to_route_ptr.second->stops.at(static_cast<int>(name_to_route_ptr.second->stops.size())/2));
 
-            if (!(first_stop == end_stop)) {
+            if (!(first_stop == end_stop)
+                && !IsCloser(first_stop, end_stop, settings_.simplification_tolerance)) {
 
-                picture_.Add(RouteUnderlinerPrintTemplate(settings_)
+                container.Add(RouteUnderlinerPrintTemplate(settings_)
                         .SetPosition(end_stop)
                         .SetData(name_to_route_ptr.first));
 
-                picture_.Add(RoutePrintTemplate(settings_)
+                container.Add(RoutePrintTemplate(settings_)
                         .SetPosition(end_stop)
-                        .SetFillColor(settings_.color_palette[color_counter])
+                        .SetFillColor(GetPaletteColor(color_counter))
                         .SetData(name_to_route_ptr.first));
             }
 
@@ -116,32 +251,39 @@ void MapRenderer::RenderRoutesNames() {
     }
 }
 
-void MapRenderer::RenderStopsCircles() {
+void MapRenderer::RenderStopsCircles(svg::ObjectContainer& container) {
 
     assert(projector_);
 
     for (const auto& i : all_stops_in_routes_) {
+        if (culled_stops_.count(i.second) != 0) {
+            continue;
+        }
         svg::Circle stop_circle;
-        stop_circle.SetCenter(projector_.value()(i.second->map_point))
+        stop_circle.SetCenter(Projected(i.second))
                     .SetRadius(settings_.stop_radius)
                     .SetFillColor("white"s);
-        picture_.Add(stop_circle);
+        container.Add(stop_circle);
     }
 
 }
 
-void MapRenderer::RenderStopsNames() {
+void MapRenderer::RenderStopsNames(svg::ObjectContainer& container) {
 
     assert(projector_);
 
     for (const auto& i : all_stops_in_routes_) {
 
-        picture_.Add(StopUnderlinerPrintTemplate(settings_)
-                             .SetPosition(projector_.value()(i.second->map_point))
+        if (culled_stops_.count(i.second) != 0) {
+            continue;
+        }
+
+        container.Add(StopUnderlinerPrintTemplate(settings_)
+                             .SetPosition(Projected(i.second))
                              .SetData(i.first));
 
-        picture_.Add(StopPrintTemplate(settings_)
-                             .SetPosition(projector_.value()(i.second->map_point))
+        container.Add(StopPrintTemplate(settings_)
+                             .SetPosition(Projected(i.second))
                              .SetFillColor("black"s)
                              .SetData(i.first));
     }
@@ -179,6 +321,7 @@ svg::Color MapRenderer::ParseColor(const json::Node& node) {
 void MapRenderer::Fill() {
 
     all_routes_ = catalogue_->GetAllRoutesPtr();
+    all_stops_in_routes_.clear();
 
     for (const auto &name_to_route_ptr: all_routes_) {
 
@@ -194,16 +337,240 @@ void MapRenderer::Fill() {
 
 std::ostream& MapRenderer::GetCompleteMap(std::ostream& output) {
 
+    profile::ScopedTimer prepare_timer("render.prepare_layers"sv);
+    PrepareLayers();
+    prepare_timer.Stop();
+
+    profile::ScopedTimer layers_timer("render.layers"sv);
+
+    std::array<svg::Document, LAYER_PASSES.size()> layers;
+    std::array<std::string, LAYER_PASSES.size()> rendered_layers;
+
+    // Formatting the tags is the expensive part, it is done on the layer threads as well
+    ForEachLayerConcurrently([&](size_t index) {
+        (this->*LAYER_PASSES[index])(layers[index]);
+        std::ostringstream layer_output;
+        layers[index].RenderObjects(layer_output);
+        rendered_layers[index] = layer_output.str();
+    });
+    layers_timer.Stop();
+
+    svg::Document::RenderHeader(output);
+    for (const auto& layer : rendered_layers) {
+        output << layer;
+    }
+    svg::Document::RenderFooter(output);
+
+    picture_ = svg::Document();
+    for (auto& layer : layers) {
+        picture_.Append(std::move(layer));
+    }
+
+    return output;
+}
+
+std::ostream& MapRenderer::GetCompleteRasterMap(std::ostream& output, raster::Format format) {
+
+    profile::ScopedTimer prepare_timer("render.prepare_layers"sv);
+    PrepareLayers();
+    prepare_timer.Stop();
+
+    std::array<raster::Canvas, LAYER_PASSES.size()> layers;
+
+    ForEachLayerConcurrently([&](size_t index) {
+        (this->*LAYER_PASSES[index])(layers[index]);
+    });
+
+    raster::Canvas canvas;
+    for (auto& layer : layers) {
+        canvas.Append(std::move(layer));
+    }
+
+    profile::ScopedTimer rasterize_timer("render.rasterize"sv);
+    auto image = canvas.Rasterize(static_cast<int>(std::ceil(settings_.width)),
+                                  static_cast<int>(std::ceil(settings_.height)));
+    raster::Write(image, format, output);
+
+    return output;
+}
+
+std::ostream& MapRenderer::GetPathMap(std::ostream& output,
+                                      const transport_catalogue::OptimalPathSearchResponse& path) {
+    svg::Document document;
+    RenderPath(document, path);
+    document.Render(output);
+    return output;
+}
+
+std::ostream& MapRenderer::GetPathRasterMap(std::ostream& output,
+                                            const transport_catalogue::OptimalPathSearchResponse& path,
+                                            raster::Format format) {
+    raster::Canvas canvas;
+    RenderPath(canvas, path);
+
+    auto image = canvas.Rasterize(static_cast<int>(std::ceil(settings_.width)),
+                                  static_cast<int>(std::ceil(settings_.height)));
+    raster::Write(image, format, output);
+
+    return output;
+}
+
+void MapRenderer::RenderPath(svg::ObjectContainer& container,
+                             const transport_catalogue::OptimalPathSearchResponse& path) {
+
+    struct Ride {
+        const Route* route_ptr;
+        std::vector<const Stop*> stops;
+    };
+
+    std::vector<Ride> rides;
+    std::map<std::string_view, const Stop*> path_stops;
+
+    for (const auto& item : path.items) {
+
+        if (item.route_ptr == nullptr) {
+            // Wait item, the stop is kept even if the path has no rides at all
+            const Stop* stop_ptr = catalogue_->GetStopPtr(item.name);
+            path_stops[stop_ptr->name] = stop_ptr;
+            continue;
+        }
+
+        Ride ride{item.route_ptr, {}};
+        const int step = item.from_index <= item.to_index ? 1 : -1;
+        for (int index = item.from_index; ; index += step) {
+            const Stop* stop_ptr = item.route_ptr->stops.at(index);
+            ride.stops.push_back(stop_ptr);
+            path_stops[stop_ptr->name] = stop_ptr;
+            if (index == item.to_index) {
+                break;
+            }
+        }
+        rides.push_back(std::move(ride));
+    }
+
+    // A path from a stop to itself has no items, nothing to draw and nothing to fit the projector to
+    if (path_stops.empty()) {
+        return;
+    }
+
+    std::vector<Coordinates> coords;
+    for (const auto& [name, stop_ptr] : path_stops) {
+        coords.push_back(stop_ptr->map_point);
+    }
+
+    const SphereProjector projector(coords.begin(), coords.end(),
+                                    settings_.width, settings_.height, settings_.padding);
+
+    for (const auto& ride : rides) {
+        svg::Polyline ride_line;
+        ride_line.SetFillColor(svg::NoneColor).
+                SetStrokeWidth(settings_.line_width).
+                SetStrokeLineCap(svg::StrokeLineCap::ROUND).
+                SetStrokeLineJoin(svg::StrokeLineJoin::ROUND).
+                SetStrokeColor(GetRouteColor(ride.route_ptr));
+        for (const auto stop_ptr : ride.stops) {
+            ride_line.AddPoint(projector(stop_ptr->map_point));
+        }
+        container.Add(ride_line);
+    }
+
+    for (const auto& ride : rides) {
+        auto boarding = projector(ride.stops.front()->map_point);
+
+        container.Add(RouteUnderlinerPrintTemplate(settings_)
+                .SetPosition(boarding)
+                .SetData(ride.route_ptr->name));
+
+        container.Add(RoutePrintTemplate(settings_)
+                .SetPosition(boarding)
+                .SetFillColor(GetRouteColor(ride.route_ptr))
+                .SetData(ride.route_ptr->name));
+    }
+
+    for (const auto& [name, stop_ptr] : path_stops) {
+        svg::Circle stop_circle;
+        stop_circle.SetCenter(projector(stop_ptr->map_point))
+                .SetRadius(settings_.stop_radius)
+                .SetFillColor("white"s);
+        container.Add(stop_circle);
+    }
+
+    for (const auto& [name, stop_ptr] : path_stops) {
+
+        container.Add(StopUnderlinerPrintTemplate(settings_)
+                              .SetPosition(projector(stop_ptr->map_point))
+                              .SetData(stop_ptr->name));
+
+        container.Add(StopPrintTemplate(settings_)
+                              .SetPosition(projector(stop_ptr->map_point))
+                              .SetFillColor("black"s)
+                              .SetData(stop_ptr->name));
+    }
+}
+
+const svg::Color& MapRenderer::GetPaletteColor(size_t index) const {
+
+    // Without a palette the routes are drawn with the same color as the stop labels
+    static const svg::Color DEFAULT_COLOR{"black"s};
+    if (settings_.color_palette.empty()) {
+        return DEFAULT_COLOR;
+    }
+    return settings_.color_palette[index % settings_.color_palette.size()];
+}
+
+const svg::Color& MapRenderer::GetRouteColor(const Route* route) {
+
+    // The catalogue may have been edited since the colors were assigned
+    if (route_colors_generation_ != catalogue_->GetGeneration()) {
+        route_color_index_.clear();
+        route_colors_generation_ = catalogue_->GetGeneration();
+    }
+
+    if (route_color_index_.empty()) {
+        // Same assignment as RenderRoutes: palette cycles over non-empty routes sorted by name
+        size_t color_counter = 0;
+        for (const auto& [name, route_ptr] : catalogue_->GetAllRoutesPtr()) {
+            if (route_ptr->stops.empty()) {
+                continue;
+            }
+            route_color_index_[route_ptr] = color_counter;
+            ++color_counter;
+        }
+    }
+
+    return GetPaletteColor(route_color_index_.at(route));
+}
+
+void MapRenderer::PrepareLayers() {
     Fill();
     CreateSphereProjector();
-    RenderRoutes();
-    RenderRoutesNames();
-    RenderStopsCircles();
-    RenderStopsNames();
+    ProjectStops();
+    CullStops();
+}
 
-    RenderRouteMap(output);
+void MapRenderer::ProjectStops() {
 
-    return output;
+    assert(projector_);
+
+    projected_stops_.assign(catalogue_->GetConstStopsPtr()->size(), svg::Point());
+
+    for (const auto& name_to_stop_ptr : all_stops_in_routes_) {
+        projected_stops_[name_to_stop_ptr.second->id] = projector_.value()(name_to_stop_ptr.second->map_point);
+    }
+}
+
+void MapRenderer::ForEachLayerConcurrently(const std::function<void(size_t)>& task) const {
+
+    std::vector<std::future<void>> futures;
+    for (size_t index = 1; index < LAYER_PASSES.size(); ++index) {
+        futures.push_back(std::async(std::launch::async, task, index));
+    }
+
+    task(0);
+
+    for (auto& future : futures) {
+        future.get();
+    }
 }
 
 const svg::Document& MapRenderer::GetMapDocumentRef() const {
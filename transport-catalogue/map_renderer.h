@@ -7,10 +7,14 @@
 #include <variant>
 #include <memory>
 #include <sstream>
+#include <array>
+#include <functional>
+#include <unordered_set>
 
 #include "json.h"
 #include "domain.h"
 #include "svg.h"
+#include "raster.h"
 #include "transport_catalogue.h"
 #include "geo.h"
 
@@ -39,6 +43,11 @@ struct Settings {
     double underlayer_width = 0;
 
     std::vector<svg::Color> color_palette;
+
+    // Level of detail: route lines are simplified in projected space with this
+    // tolerance (in pixels) and stops closer than it to an already drawn stop
+    // lose their circle and label. Zero keeps every vertex.
+    double simplification_tolerance = 0;
 };
 
 class RoutePrintTemplate : public svg::Text {
@@ -94,20 +103,39 @@ public:
 
     explicit MapRenderer(transport_catalogue::TransportCatalogue* ptr);
 
-    void RenderRoutes();
+    void RenderRoutes(svg::ObjectContainer& container);
+
+    void RenderRoutesNames(svg::ObjectContainer& container);
 
-    void RenderRoutesNames();
+    void RenderStopsCircles(svg::ObjectContainer& container);
 
-    void RenderStopsCircles();
+    void RenderStopsNames(svg::ObjectContainer& container);
 
-    void RenderStopsNames();
+    // Projects every stop used by routes once, render passes read the flat array
+    void ProjectStops();
 
     void CreateSphereProjector();
 
+    void CullStops();
+
     void Fill();
 
     std::ostream& GetCompleteMap(std::ostream& output);
 
+    // Same render passes drawn into a bitmap of settings width x height
+    std::ostream& GetCompleteRasterMap(std::ostream& output, raster::Format format);
+
+    // False if the settings width or height is beyond raster::MAX_IMAGE_SIDE, such maps are not rasterized
+    bool IsRasterSizeSupported() const {
+        return raster::IsImageSizeSupported(settings_.width, settings_.height);
+    }
+
+    // Draws only the rides and stops of an already found path, the projector is fitted to the path
+    std::ostream& GetPathMap(std::ostream& output, const transport_catalogue::OptimalPathSearchResponse& path);
+
+    std::ostream& GetPathRasterMap(std::ostream& output, const transport_catalogue::OptimalPathSearchResponse& path,
+                                   raster::Format format);
+
     std::ostream& RenderRouteMap(std::ostream& output);
 
     const svg::Document& GetMapDocumentRef() const;
@@ -123,9 +151,49 @@ private:
 
     std::map<std::string, const Route*> all_routes_;
     std::map<std::string, const Stop*> all_stops_in_routes_;
+    std::unordered_set<const Stop*> culled_stops_;
+
+    // Indexed by Stop::id, filled only for stops in all_stops_in_routes_
+    std::vector<svg::Point> projected_stops_;
+
+    using RenderPass = void (MapRenderer::*)(svg::ObjectContainer&);
+
+    // Layers in the order they have to appear in the picture
+    static constexpr std::array<RenderPass, 4> LAYER_PASSES = {
+            &MapRenderer::RenderRoutes,
+            &MapRenderer::RenderRoutesNames,
+            &MapRenderer::RenderStopsCircles,
+            &MapRenderer::RenderStopsNames,
+    };
+
+    // Render passes only read the renderer state, so each layer is built on its own thread
+    void ForEachLayerConcurrently(const std::function<void(size_t)>& task) const;
+
+    void PrepareLayers();
+
+    void RenderPath(svg::ObjectContainer& container, const transport_catalogue::OptimalPathSearchResponse& path);
+
+    // Palette colors cycle, a default color is used if the palette is empty
+    const svg::Color& GetPaletteColor(size_t index) const;
+
+    // Palette color the route gets on the complete map
+    const svg::Color& GetRouteColor(const Route* route);
+
+    std::unordered_map<const Route*, size_t> route_color_index_;
+    uint64_t route_colors_generation_ = 0;
+
+    svg::Point Projected(const Stop* stop) const {
+        return projected_stops_[stop->id];
+    }
 
     [[nodiscard]] static svg::Color ParseColor(const json::Node& node);
 
+    // Douglas-Peucker simplification, first and last points are always kept
+    [[nodiscard]] static std::vector<svg::Point> SimplifyPolyline(const std::vector<svg::Point>& points,
+                                                                  double tolerance);
+
+    [[nodiscard]] static bool IsCloser(svg::Point lhs, svg::Point rhs, double tolerance);
+
 };
 
 } // end namespace renderer
\ No newline at end of file
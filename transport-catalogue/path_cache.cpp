@@ -0,0 +1,82 @@
+#include "path_cache.h"
+
+#include <algorithm>
+
+#include "profile.h"
+
+namespace transport_catalogue {
+
+    PathCache::PathCache(size_t capacity)
+        : shard_capacity_(std::max<size_t>(capacity / SHARD_COUNT, 1))
+    {
+    }
+
+    bool PathCache::Shard::Synchronize(uint64_t new_generation) {
+        if (new_generation < generation) {
+            return false;
+        }
+        if (new_generation > generation) {
+            entries.clear();
+            index.clear();
+            generation = new_generation;
+        }
+        return true;
+    }
+
+    PathCache::Value PathCache::Find(Key key, uint64_t generation) {
+
+        auto& shard = GetShard(key);
+        {
+            std::lock_guard guard(shard.mutex);
+            if (shard.Synchronize(generation)) {
+                if (auto it = shard.index.find(key); it != shard.index.end()) {
+                    shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+                    ++hits_;
+                    profile::Count("path_cache.hits");
+                    return it->second->second;
+                }
+            }
+        }
+
+        ++misses_;
+        profile::Count("path_cache.misses");
+        return nullptr;
+    }
+
+    void PathCache::Insert(Key key, uint64_t generation, Value value) {
+
+        auto& shard = GetShard(key);
+        std::lock_guard guard(shard.mutex);
+        if (!shard.Synchronize(generation)) {
+            return;
+        }
+
+        if (auto it = shard.index.find(key); it != shard.index.end()) {
+            // Another reader has computed the same path meanwhile
+            it->second->second = std::move(value);
+            shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+            return;
+        }
+
+        if (shard.entries.size() >= shard_capacity_) {
+            shard.index.erase(shard.entries.back().first);
+            shard.entries.pop_back();
+        }
+        shard.entries.emplace_front(key, std::move(value));
+        shard.index.emplace(key, shard.entries.begin());
+    }
+
+    PathCacheStats PathCache::GetStats() const {
+
+        PathCacheStats stats;
+        stats.hits = hits_;
+        stats.misses = misses_;
+        stats.capacity = shard_capacity_ * SHARD_COUNT;
+        for (const auto& shard : shards_) {
+            std::lock_guard guard(shard.mutex);
+            stats.size += shard.entries.size();
+        }
+        return stats;
+    }
+
+} // end of namespace: transport_catalogue
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace transport_catalogue {
+
+struct OptimalPathSearchResponse;
+
+struct PathCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    size_t size = 0;
+    size_t capacity = 0;
+};
+
+// Bounded cache of the answers to the optimal path requests keyed by the stop ids of (from, to).
+// Entries belong to a generation of the catalogue: the first access with a newer generation drops
+// everything stored before. The keys are split between shards, each one with its own lock and its
+// own least recently used order, so concurrent readers rarely wait for each other.
+class PathCache {
+public:
+    using Key = std::pair<int, int>;
+    using Value = std::shared_ptr<const OptimalPathSearchResponse>;
+
+    explicit PathCache(size_t capacity);
+
+    PathCache(const PathCache&) = delete;
+    PathCache& operator=(const PathCache&) = delete;
+
+    // nullptr on a miss
+    Value Find(Key key, uint64_t generation);
+
+    // Evicts the least recently used entry of the shard if it is full
+    void Insert(Key key, uint64_t generation, Value value);
+
+    PathCacheStats GetStats() const;
+
+private:
+    static constexpr size_t SHARD_COUNT = 16;
+
+    struct KeyHash {
+        size_t operator()(Key key) const {
+            return std::hash<uint64_t>{}((static_cast<uint64_t>(key.first) << 32) ^ static_cast<uint32_t>(key.second));
+        }
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        uint64_t generation = 0;
+        // The most recently used entry first
+        std::list<std::pair<Key, Value>> entries;
+        std::unordered_map<Key, std::list<std::pair<Key, Value>>::iterator, KeyHash> index;
+
+        // Drops the entries of an older generation, false if the shard is already newer.
+        // The lock is to be held
+        bool Synchronize(uint64_t new_generation);
+    };
+
+    size_t shard_capacity_;
+    std::array<Shard, SHARD_COUNT> shards_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+
+    Shard& GetShard(Key key) {
+        return shards_[KeyHash{}(key) % SHARD_COUNT];
+    }
+};
+
+} // end of namespace: transport_catalogue
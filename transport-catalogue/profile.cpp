@@ -0,0 +1,369 @@
+#include "profile.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "json.h"
+#include "json_builder.h"
+
+using namespace std::literals;
+
+namespace profile {
+
+namespace detail {
+
+bool is_enabled = false;
+
+bool counts_allocations = false;
+
+// Updated from operator new, so they must not allocate themselves
+std::atomic<uint64_t> allocations{0};
+std::atomic<uint64_t> allocated_bytes{0};
+
+} // end namespace detail
+
+struct TimerStat {
+    uint64_t count = 0;
+    double total_ms = 0;
+    double max_ms = 0;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::string sink;
+    std::chrono::steady_clock::time_point start;
+
+    // Timers are reported in the order of their first use
+    std::vector<std::string> timer_order;
+    std::map<std::string, TimerStat, std::less<>> timers;
+    std::map<std::string, uint64_t, std::less<>> counters;
+};
+
+static Registry& GetRegistry() {
+    static Registry registry;
+    return registry;
+}
+
+// Histogram written by one thread only and read by the report, so relaxed
+// loads and stores are enough and recording needs no read-modify-write
+struct ThreadHistogram {
+    std::array<std::atomic<uint64_t>, Histogram::BUCKET_COUNT> counts{};
+
+    void Record(uint64_t value) {
+        auto& count = counts[Histogram::BucketIndex(value)];
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void AddTo(Histogram& histogram) const {
+        for (size_t index = 0; index < counts.size(); ++index) {
+            if (const uint64_t count = counts[index].load(std::memory_order_relaxed)) {
+                histogram.AddToBucket(index, count);
+            }
+        }
+    }
+};
+
+// Histograms outlive their threads, they are owned here and merged by name
+struct LatencyRegistry {
+    std::mutex mutex;
+    std::vector<std::pair<std::string, std::unique_ptr<ThreadHistogram>>> histograms;
+};
+
+static LatencyRegistry& GetLatencyRegistry() {
+    static LatencyRegistry registry;
+    return registry;
+}
+
+static json::Node::Value CounterValue(uint64_t value) {
+    // json::Node keeps int or double only
+    if (value <= static_cast<uint64_t>(INT_MAX)) {
+        return static_cast<int>(value);
+    }
+    return static_cast<double>(value);
+}
+
+void Enable(std::string sink) {
+    auto& registry = GetRegistry();
+    std::lock_guard guard(registry.mutex);
+    registry.sink = std::move(sink);
+    registry.start = std::chrono::steady_clock::now();
+    detail::allocations = 0;
+    detail::allocated_bytes = 0;
+    detail::is_enabled = true;
+}
+
+void Disable() {
+    auto& registry = GetRegistry();
+    std::lock_guard guard(registry.mutex);
+    detail::is_enabled = false;
+}
+
+const char* SinkFromEnvironment() {
+    return std::getenv("TC_PROFILE");
+}
+
+void AddTime(std::string_view name, std::chrono::steady_clock::duration duration) {
+    if (!IsEnabled()) {
+        return;
+    }
+    const double ms = std::chrono::duration<double, std::milli>(duration).count();
+
+    auto& registry = GetRegistry();
+    std::lock_guard guard(registry.mutex);
+    auto it = registry.timers.find(name);
+    if (it == registry.timers.end()) {
+        registry.timer_order.emplace_back(name);
+        it = registry.timers.emplace(std::string(name), TimerStat{}).first;
+    }
+    ++it->second.count;
+    it->second.total_ms += ms;
+    it->second.max_ms = std::max(it->second.max_ms, ms);
+}
+
+void Count(std::string_view name, uint64_t value) {
+    if (!IsEnabled()) {
+        return;
+    }
+    auto& registry = GetRegistry();
+    std::lock_guard guard(registry.mutex);
+    auto it = registry.counters.find(name);
+    if (it == registry.counters.end()) {
+        it = registry.counters.emplace(std::string(name), 0).first;
+    }
+    it->second += value;
+}
+
+double GetTotalTime(std::string_view name) {
+    auto& registry = GetRegistry();
+    std::lock_guard guard(registry.mutex);
+    auto it = registry.timers.find(name);
+    return it == registry.timers.end() ? 0.0 : it->second.total_ms;
+}
+
+void WriteReport(std::ostream& output) {
+    auto& registry = GetRegistry();
+    std::lock_guard guard(registry.mutex);
+
+    json::Array timers;
+    for (const auto& name : registry.timer_order) {
+        const auto& stat = registry.timers.find(name)->second;
+        timers.emplace_back(json::Builder{}.StartDict()
+                .Key("name"s).Value(name)
+                .Key("count"s).Value(CounterValue(stat.count))
+                .Key("total_ms"s).Value(stat.total_ms)
+                .Key("mean_ms"s).Value(stat.total_ms / static_cast<double>(stat.count))
+                .Key("max_ms"s).Value(stat.max_ms)
+                .EndDict().Build());
+    }
+
+    json::Builder counters;
+    counters.StartDict();
+    for (const auto& [name, value] : registry.counters) {
+        counters.Key(name).Value(CounterValue(value));
+    }
+    if (detail::counts_allocations) {
+        counters.Key("memory.allocations"s).Value(CounterValue(detail::allocations.load(std::memory_order_relaxed)));
+        counters.Key("memory.allocated_bytes"s).Value(CounterValue(detail::allocated_bytes.load(std::memory_order_relaxed)));
+    }
+    counters.EndDict();
+
+    const auto latency = LatencyReport();
+
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+
+    const double wall_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - registry.start).count();
+
+    json::Print(json::Document(json::Builder{}.StartDict()
+                                       .Key("wall_ms"s).Value(wall_ms)
+                                       .Key("peak_rss_kb"s).Value(CounterValue(usage.ru_maxrss))
+                                       .Key("timers"s).Value(std::move(timers))
+                                       .Key("counters"s).Value(counters.Build().AsDict())
+                                       .Key("latency_us"s).Value(latency)
+                                       .EndDict().Build()),
+                output);
+    output << std::endl;
+}
+
+void WriteReport() {
+    if (!IsEnabled()) {
+        return;
+    }
+    const std::string sink = GetRegistry().sink;
+    if (sink.empty() || sink == "1"s || sink == "stderr"s) {
+        WriteReport(std::cerr);
+        return;
+    }
+    std::ofstream output(sink);
+    if (!output) {
+        std::cerr << "Unable to write profile report to "sv << sink << std::endl;
+        return;
+    }
+    WriteReport(output);
+}
+
+// ------------------ Latency ------------------
+
+void RecordLatency(std::string_view name, std::chrono::steady_clock::duration duration) {
+
+    // A handful of request types, a linear search is cheaper than hashing
+    thread_local std::vector<std::pair<std::string, ThreadHistogram*>> histograms;
+
+    ThreadHistogram* histogram = nullptr;
+    for (const auto& [histogram_name, histogram_ptr] : histograms) {
+        if (histogram_name == name) {
+            histogram = histogram_ptr;
+            break;
+        }
+    }
+
+    if (histogram == nullptr) {
+        auto& registry = GetLatencyRegistry();
+        std::lock_guard guard(registry.mutex);
+        registry.histograms.emplace_back(std::string(name), std::make_unique<ThreadHistogram>());
+        histogram = registry.histograms.back().second.get();
+        histograms.emplace_back(std::string(name), histogram);
+    }
+
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    histogram->Record(static_cast<uint64_t>(std::max<int64_t>(ns, 0)));
+}
+
+json::Dict LatencyReport() {
+
+    std::map<std::string, Histogram> merged;
+    {
+        auto& registry = GetLatencyRegistry();
+        std::lock_guard guard(registry.mutex);
+        for (const auto& [name, histogram] : registry.histograms) {
+            histogram->AddTo(merged[name]);
+        }
+    }
+
+    json::Dict report;
+    for (const auto& [name, histogram] : merged) {
+        report.emplace(name, ToJson(histogram));
+    }
+    return report;
+}
+
+json::Dict ToJson(const Histogram& histogram) {
+    const auto to_us = [](uint64_t ns) {
+        return static_cast<double>(ns) / 1000.0;
+    };
+
+    return json::Builder{}.StartDict()
+            .Key("count"s).Value(CounterValue(histogram.GetCount()))
+            .Key("mean"s).Value(histogram.GetMean() / 1000.0)
+            .Key("p50"s).Value(to_us(histogram.ValueAtPercentile(50)))
+            .Key("p90"s).Value(to_us(histogram.ValueAtPercentile(90)))
+            .Key("p99"s).Value(to_us(histogram.ValueAtPercentile(99)))
+            .Key("p999"s).Value(to_us(histogram.ValueAtPercentile(99.9)))
+            .Key("max"s).Value(to_us(histogram.GetMax()))
+            .EndDict().Build().AsDict();
+}
+
+ScopedLatency::ScopedLatency(std::string_view name)
+    : name_(name), start_(std::chrono::steady_clock::now())
+{
+}
+
+ScopedLatency::~ScopedLatency() {
+    RecordLatency(name_, std::chrono::steady_clock::now() - start_);
+}
+
+// ------------------ ScopedTimer ------------------
+
+ScopedTimer::ScopedTimer(std::string_view name)
+    : is_active_(IsEnabled())
+{
+    if (is_active_) {
+        name_ = std::string(name);
+        start_ = std::chrono::steady_clock::now();
+    }
+}
+
+ScopedTimer::ScopedTimer(std::string_view prefix, std::string_view suffix)
+    : is_active_(IsEnabled())
+{
+    if (is_active_) {
+        name_.reserve(prefix.size() + suffix.size());
+        name_.append(prefix).append(suffix);
+        start_ = std::chrono::steady_clock::now();
+    }
+}
+
+ScopedTimer::~ScopedTimer() {
+    Stop();
+}
+
+void ScopedTimer::Stop() {
+    if (is_active_) {
+        AddTime(name_, std::chrono::steady_clock::now() - start_);
+        is_active_ = false;
+    }
+}
+
+// ------------------ Session ------------------
+
+Session::Session(const char* sink) {
+    if (sink != nullptr) {
+        Enable(sink);
+    }
+}
+
+Session::~Session() {
+    WriteReport();
+}
+
+// ------------------ CountingBuffer ------------------
+
+CountingBuffer::CountingBuffer(std::streambuf* target, std::string counter_name)
+    : target_(target), counter_name_(std::move(counter_name))
+{
+}
+
+CountingBuffer::~CountingBuffer() {
+    Count(counter_name_, bytes_);
+}
+
+CountingBuffer::int_type CountingBuffer::underflow() {
+    const std::streamsize count = target_->sgetn(buffer_, sizeof(buffer_));
+    if (count <= 0) {
+        return traits_type::eof();
+    }
+    bytes_ += static_cast<uint64_t>(count);
+    setg(buffer_, buffer_, buffer_ + count);
+    return traits_type::to_int_type(buffer_[0]);
+}
+
+CountingBuffer::int_type CountingBuffer::overflow(int_type ch) {
+    if (traits_type::eq_int_type(ch, traits_type::eof())) {
+        return traits_type::not_eof(ch);
+    }
+    ++bytes_;
+    return target_->sputc(traits_type::to_char_type(ch));
+}
+
+std::streamsize CountingBuffer::xsputn(const char* data, std::streamsize count) {
+    const std::streamsize written = target_->sputn(data, count);
+    bytes_ += static_cast<uint64_t>(std::max<std::streamsize>(written, 0));
+    return written;
+}
+
+int CountingBuffer::sync() {
+    return target_->pubsync();
+}
+
+} // end namespace profile
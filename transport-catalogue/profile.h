@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+#include "histogram.h"
+#include "json.h"
+
+// Built-in instrumentation: scoped phase timers and named counters, reported as JSON at exit.
+// Everything is a no-op until Enable() is called, so the calls may stay in the production code.
+//
+//     profile::Session session(profile::SinkFromEnvironment());   // TC_PROFILE=stderr|<file>
+//     {
+//         profile::ScopedTimer timer("process_requests.read_base");
+//         ...
+//     }
+//     profile::Count("router.edges_relaxed", relaxed);
+
+namespace profile {
+
+// Turns the instrumentation on. sink is "stderr" (or empty) or a path of the report file
+void Enable(std::string sink);
+
+// Stops recording, what was recorded stays for the report
+void Disable();
+
+inline bool IsEnabled();
+
+// Value of the TC_PROFILE environment variable, nullptr if it is not set
+const char* SinkFromEnvironment();
+
+void AddTime(std::string_view name, std::chrono::steady_clock::duration duration);
+
+void Count(std::string_view name, uint64_t value = 1);
+
+// Milliseconds recorded under the timer name so far, 0 if it has not been used
+double GetTotalTime(std::string_view name);
+
+// Writes the report to the sink given in Enable(), does nothing if profiling is disabled
+void WriteReport();
+
+void WriteReport(std::ostream& output);
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(std::string_view name);
+
+    // The name is "<prefix><suffix>", it is concatenated only when profiling is enabled
+    ScopedTimer(std::string_view prefix, std::string_view suffix);
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    ~ScopedTimer();
+
+    // Records the time now instead of in the destructor
+    void Stop();
+
+private:
+    bool is_active_;
+    std::string name_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Request latencies are recorded whether profiling is enabled or not: every thread writes into
+// its own histograms without locks, they are merged only when a report is requested
+void RecordLatency(std::string_view name, std::chrono::steady_clock::duration duration);
+
+// Count, mean, p50, p90, p99, p999 and max in microseconds for every recorded name
+json::Dict LatencyReport();
+
+// The same summary for one histogram of nanoseconds
+json::Dict ToJson(const Histogram& histogram);
+
+class ScopedLatency {
+public:
+    explicit ScopedLatency(std::string_view name);
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+    ~ScopedLatency();
+
+private:
+    std::string_view name_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Enables profiling for the lifetime of the object and writes the report in the destructor.
+// A null sink leaves profiling disabled.
+class Session {
+public:
+    explicit Session(const char* sink);
+
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+
+    ~Session();
+};
+
+// Stream buffer that forwards to another one and counts the passed bytes,
+// used to measure the size of the JSON input and output
+class CountingBuffer : public std::streambuf {
+public:
+    CountingBuffer(std::streambuf* target, std::string counter_name);
+
+    ~CountingBuffer() override;
+
+protected:
+    int_type underflow() override;
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* data, std::streamsize count) override;
+    int sync() override;
+
+private:
+    std::streambuf* target_;
+    std::string counter_name_;
+    char buffer_[4096];
+    uint64_t bytes_ = 0;
+};
+
+namespace detail {
+
+extern bool is_enabled;
+
+// Set by profile_allocations.cpp, the replacement of the global operator new linked only into the
+// application. The memory.* counters are reported only where the allocations are actually counted
+extern bool counts_allocations;
+extern std::atomic<uint64_t> allocations;
+extern std::atomic<uint64_t> allocated_bytes;
+
+} // end namespace detail
+
+inline bool IsEnabled() {
+    return detail::is_enabled;
+}
+
+} // end namespace profile
@@ -0,0 +1,45 @@
+#include "profile.h"
+
+#include <cstdlib>
+#include <new>
+
+// Global allocation counting for the memory.* counters of the profile report. It replaces operator new
+// of the whole program, so it is linked into the application only and not into the core library.
+// The check of the flag is the only cost while profiling is disabled.
+
+namespace profile::detail {
+
+static const bool allocation_hook_installed = (counts_allocations = true);
+
+} // end namespace profile::detail
+
+void* operator new(std::size_t size) {
+    if (profile::detail::is_enabled) {
+        profile::detail::allocations.fetch_add(1, std::memory_order_relaxed);
+        profile::detail::allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
@@ -0,0 +1,72 @@
+#include "query_log.h"
+
+#include "json_builder.h"
+
+using namespace std::literals;
+
+namespace query_log {
+
+Capture::Capture()
+    : start_(Clock::now())
+{
+}
+
+void Capture::Record(const json::Dict& request, Clock::time_point start, Clock::time_point finish) {
+    Entry entry;
+    entry.request = request;
+    entry.offset_ms = std::chrono::duration<double, std::milli>(start - start_).count();
+    entry.duration_us = std::chrono::duration<double, std::micro>(finish - start).count();
+
+    std::lock_guard guard(mutex_);
+    entries_.push_back(std::move(entry));
+}
+
+void Capture::Write(std::ostream& output, const json::Dict& serialization_settings) const {
+    std::lock_guard guard(mutex_);
+
+    json::Array requests;
+    json::Array timing;
+    requests.reserve(entries_.size());
+    timing.reserve(entries_.size());
+
+    for (const auto& entry : entries_) {
+        requests.emplace_back(entry.request);
+        timing.emplace_back(json::Builder{}.StartDict()
+                .Key("offset_ms"s).Value(entry.offset_ms)
+                .Key("duration_us"s).Value(entry.duration_us)
+                .EndDict().Build());
+    }
+
+    json::Print(json::Document(json::Builder{}.StartDict()
+                                       .Key("serialization_settings"s).Value(serialization_settings)
+                                       .Key("stat_requests"s).Value(std::move(requests))
+                                       .Key("capture"s).Value(std::move(timing))
+                                       .EndDict().Build()),
+                output);
+}
+
+std::vector<Entry> LoadEntries(const json::Document& document) {
+    const auto& root = document.GetRoot().AsDict();
+    const auto& requests = root.at("stat_requests"s).AsArray();
+
+    const json::Array* timing = nullptr;
+    if (auto it = root.find("capture"s); it != root.end()) {
+        timing = &it->second.AsArray();
+        if (timing->size() != requests.size()) {
+            throw std::runtime_error("capture and stat_requests sizes differ"s);
+        }
+    }
+
+    std::vector<Entry> entries(requests.size());
+    for (size_t index = 0; index < requests.size(); ++index) {
+        entries[index].request = requests[index].AsDict();
+        if (timing != nullptr) {
+            const auto& item = (*timing)[index].AsDict();
+            entries[index].offset_ms = item.at("offset_ms"s).AsDouble();
+            entries[index].duration_us = item.at("duration_us"s).AsDouble();
+        }
+    }
+    return entries;
+}
+
+} // end namespace query_log
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include "json.h"
+
+// Capture of stat_requests streams with their timing, for offline replay (benchmark/query_replay).
+// A written capture is a valid process_requests input with one extra key:
+//
+//     {
+//         "serialization_settings": {...},
+//         "stat_requests": [...],
+//         "capture": [{"offset_ms": 0.0, "duration_us": 12.5}, ...]   // one per stat request
+//     }
+
+namespace query_log {
+
+using Clock = std::chrono::steady_clock;
+
+struct Entry {
+    json::Dict request;
+
+    // Time from the start of the capture to the arrival of the request
+    double offset_ms = 0;
+
+    // Time the request took when it was captured
+    double duration_us = 0;
+};
+
+class Capture {
+public:
+    Capture();
+
+    void Record(const json::Dict& request, Clock::time_point start, Clock::time_point finish);
+
+    void Write(std::ostream& output, const json::Dict& serialization_settings) const;
+
+private:
+    Clock::time_point start_;
+    mutable std::mutex mutex_;
+    std::vector<Entry> entries_;
+};
+
+// Reads entries back from a capture. Any process_requests input is accepted as well,
+// its requests then all have zero offsets.
+std::vector<Entry> LoadEntries(const json::Document& document);
+
+} // end namespace query_log
@@ -0,0 +1,193 @@
+#include "raptor.h"
+
+#include <algorithm>
+
+#include "profile.h"
+
+namespace transport_catalogue {
+
+    RaptorRouter::RaptorRouter(const RouterSettings& settings, const std::deque<Route>& routes, size_t stop_count)
+        : settings_(settings), stop_count_(stop_count)
+    {
+        for (const auto& route : routes) {
+            const int size = static_cast<int>(route.stops.size());
+            if (size < 2) {
+                continue;
+            }
+            if (route.is_roundtrip) {
+                AddPattern(route, 0, size - 1);
+                continue;
+            }
+
+            // The halves of the stored way there and back, as in TransportRouter::ForEachRide
+            const int middle = size / 2 + 1;
+            AddPattern(route, 0, middle - 1);
+            AddPattern(route, middle - 1, 0);
+            AddPattern(route, middle - 1, size - 1);
+            if (middle < size) {
+                AddPattern(route, size - 1, middle);
+            }
+        }
+
+        // Patterns of every stop in the compressed form
+        stop_pattern_offsets_.assign(stop_count_ + 1, 0);
+        for (const auto& pattern_stop : pattern_stops_) {
+            ++stop_pattern_offsets_[pattern_stop.stop_id + 1];
+        }
+        for (size_t stop = 0; stop < stop_count_; ++stop) {
+            stop_pattern_offsets_[stop + 1] += stop_pattern_offsets_[stop];
+        }
+
+        stop_patterns_.resize(pattern_stops_.size());
+        auto next = stop_pattern_offsets_;
+        for (uint32_t pattern = 0; pattern < patterns_.size(); ++pattern) {
+            for (uint32_t position = 0; position < patterns_[pattern].size; ++position) {
+                const auto stop_id = pattern_stops_[patterns_[pattern].first + position].stop_id;
+                stop_patterns_[next[stop_id]++] = StopPattern{pattern, position};
+            }
+        }
+    }
+
+    void RaptorRouter::AddPattern(const Route& route, int first_index, int last_index) {
+
+        if (first_index == last_index) {
+            return;
+        }
+
+        const int step = first_index < last_index ? 1 : -1;
+
+        Pattern pattern{&route, static_cast<uint32_t>(pattern_stops_.size()), 0};
+        for (int index = first_index; index != last_index + step; index += step) {
+            pattern_stops_.push_back(PatternStop{static_cast<uint32_t>(route.stops[index]->id),
+                                                 index,
+                                                 route.GetRideDistance(first_index, index)});
+            ++pattern.size;
+        }
+        patterns_.push_back(pattern);
+    }
+
+    double RaptorRouter::GetRideTime(const PatternStop& from, const PatternStop& to) const {
+
+        // Coefficient from km/h to meters/minute = 0.06;
+        static const double MULTIPLY_COEF = 0.06;
+
+        const double real_dist = to.distance - from.distance;
+        return MULTIPLY_COEF * (real_dist / settings_.bus_velocity_) + settings_.bus_wait_time_;
+    }
+
+    std::vector<RaptorJourney> RaptorRouter::FindJourneys(VertexId from, VertexId to, int max_rides) const {
+
+        std::vector<RaptorJourney> journeys;
+
+        std::vector<std::vector<Label>> labels(1, std::vector<Label>(stop_count_));
+        labels[0][from].time = 0.0;
+        if (from == to) {
+            journeys.emplace_back();
+            return journeys;
+        }
+
+        // Best arrival of every stop over the rounds so far, a ride is kept only if it improves it
+        std::vector<double> best(stop_count_, std::numeric_limits<double>::infinity());
+        best[from] = 0.0;
+
+        std::vector<VertexId> marked{from};
+        std::vector<uint32_t> first_position(patterns_.size(), NO_PATTERN);
+        std::vector<uint32_t> queue;
+        std::vector<bool> is_marked(stop_count_, false);
+        uint64_t scanned_stops = 0;
+
+        for (int round = 1; round <= max_rides && !marked.empty(); ++round) {
+
+            labels.push_back(labels.back());
+            const auto& previous = labels[round - 1];
+            auto& current = labels[round];
+
+            // Every pattern is scanned once from the earliest stop improved in the previous round
+            queue.clear();
+            for (const VertexId stop : marked) {
+                for (auto index = stop_pattern_offsets_[stop]; index < stop_pattern_offsets_[stop + 1]; ++index) {
+                    const auto [pattern, position] = stop_patterns_[index];
+                    if (first_position[pattern] == NO_PATTERN) {
+                        queue.push_back(pattern);
+                        first_position[pattern] = position;
+                    } else {
+                        first_position[pattern] = std::min(first_position[pattern], position);
+                    }
+                }
+            }
+            marked.clear();
+
+            for (const uint32_t pattern_id : queue) {
+                const auto& pattern = patterns_[pattern_id];
+                const auto* stops = pattern_stops_.data() + pattern.first;
+
+                uint32_t board_position = NO_PATTERN;
+                double board_key = std::numeric_limits<double>::infinity();
+
+                for (uint32_t position = first_position[pattern_id]; position < pattern.size; ++position) {
+                    const auto stop_id = stops[position].stop_id;
+                    ++scanned_stops;
+
+                    if (board_position != NO_PATTERN) {
+                        const double arrival = previous[stops[board_position].stop_id].time
+                                               + GetRideTime(stops[board_position], stops[position]);
+                        if (arrival < best[stop_id] && arrival < best[to]) {
+                            best[stop_id] = arrival;
+                            current[stop_id] = Label{arrival, pattern_id, board_position, position, round};
+                            if (!is_marked[stop_id]) {
+                                is_marked[stop_id] = true;
+                                marked.push_back(stop_id);
+                            }
+                        }
+                    }
+
+                    // Boarding here is better if it reaches the next stops earlier
+                    if (const double time = previous[stop_id].time; time < std::numeric_limits<double>::infinity()) {
+                        const double key = time - GetRideTime(stops[0], stops[position]);
+                        if (key < board_key) {
+                            board_key = key;
+                            board_position = position;
+                        }
+                    }
+                }
+                first_position[pattern_id] = NO_PATTERN;
+            }
+
+            for (const VertexId stop : marked) {
+                is_marked[stop] = false;
+            }
+
+            if (current[to].time < previous[to].time) {
+                journeys.push_back(RestoreJourney(labels, round, to));
+            }
+        }
+
+        profile::Count("raptor.scanned_stops", scanned_stops);
+
+        return journeys;
+    }
+
+    RaptorJourney RaptorRouter::RestoreJourney(const std::vector<std::vector<Label>>& labels, int round,
+                                               VertexId to) const {
+
+        RaptorJourney journey;
+        journey.total_time = labels[round][to].time;
+
+        VertexId stop = to;
+        for (const Label* label = &labels[round][to]; label->pattern != NO_PATTERN; ) {
+            const auto& pattern = patterns_[label->pattern];
+            const auto& board = pattern_stops_[pattern.first + label->board_position];
+            const auto& alight = pattern_stops_[pattern.first + label->alight_position];
+
+            journey.rides.push_back(RaptorRide{pattern.route_ptr, board.route_index, alight.route_index,
+                                               label->time - labels[label->round - 1][board.stop_id].time});
+
+            stop = board.stop_id;
+            label = &labels[label->round - 1][stop];
+        }
+        std::reverse(journey.rides.begin(), journey.rides.end());
+
+        return journey;
+    }
+
+} // end of namespace: transport_catalogue
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <vector>
+
+#include "domain.h"
+#include "transport_router.h"
+
+namespace transport_catalogue {
+
+    // One ride of a journey: the route covers route_ptr->stops from from_index to to_index
+    struct RaptorRide {
+        const Route* route_ptr = nullptr;
+        int from_index = 0;
+        int to_index = 0;
+        double time = 0.0;
+    };
+
+    struct RaptorJourney {
+        std::vector<RaptorRide> rides;
+        double total_time = 0.0;
+    };
+
+// Round-based search of the journeys which are best in both total time and number of rides (RAPTOR).
+// Round k finds the fastest journeys with k rides by scanning the routes which serve the stops improved
+// in round k - 1. The routes are split into patterns, stop sequences ridden in one direction, with the
+// same rides as the edges of TransportRouter: a round route is one pattern, a non-round one gets
+// both directions of each half of its stops. Pattern stops are stored route-major in flat arrays.
+class RaptorRouter {
+public:
+
+    // The distances of the routes are to be filled, see Route::forward_distances
+    RaptorRouter(const RouterSettings& settings, const std::deque<Route>& routes, size_t stop_count);
+
+    // Pareto front of the journeys with at most max_rides rides, the fewest rides first.
+    // Every next journey has more rides and is faster than the previous one.
+    std::vector<RaptorJourney> FindJourneys(VertexId from, VertexId to, int max_rides) const;
+
+private:
+    static constexpr uint32_t NO_PATTERN = std::numeric_limits<uint32_t>::max();
+
+    struct Pattern {
+        const Route* route_ptr = nullptr;
+        uint32_t first = 0;       // position of the first stop in the flat arrays
+        uint32_t size = 0;
+    };
+
+    // Pattern stop: its stop, index in the route and road distance from the pattern start
+    struct PatternStop {
+        uint32_t stop_id = 0;
+        int route_index = 0;
+        int distance = 0;
+    };
+
+    // Stop of a pattern seen from the stop
+    struct StopPattern {
+        uint32_t pattern = 0;
+        uint32_t position = 0;
+    };
+
+    // Best arrival at a stop in a round and the ride which gave it
+    struct Label {
+        double time = std::numeric_limits<double>::infinity();
+        uint32_t pattern = NO_PATTERN;
+        uint32_t board_position = 0;
+        uint32_t alight_position = 0;
+        int round = 0;
+    };
+
+    RouterSettings settings_;
+    size_t stop_count_ = 0;
+
+    std::vector<Pattern> patterns_;
+    std::vector<PatternStop> pattern_stops_;
+
+    // Patterns of every stop: stop_patterns_[stop_pattern_offsets_[stop] .. stop_pattern_offsets_[stop + 1])
+    std::vector<uint32_t> stop_pattern_offsets_;
+    std::vector<StopPattern> stop_patterns_;
+
+    // Stops of the route from first_index to last_index, both included, in either direction
+    void AddPattern(const Route& route, int first_index, int last_index);
+
+    // Time of the ride with the waiting, computed the same way as for the edges of TransportRouter
+    double GetRideTime(const PatternStop& from, const PatternStop& to) const;
+
+    RaptorJourney RestoreJourney(const std::vector<std::vector<Label>>& labels, int round, VertexId to) const;
+};
+
+} // end of namespace: transport_catalogue
@@ -0,0 +1,641 @@
+#include "raster.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <thread>
+#include <unordered_map>
+
+namespace raster {
+
+using namespace std::literals;
+
+// Printable ASCII 0x20..0x7E, 5x7 cell, one byte per row, bit 4 is the leftmost column
+static const uint8_t FONT_5X7[95][7] = {
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // ' '
+        {0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04}, // '!'
+        {0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00}, // '"'
+        {0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A}, // '#'
+        {0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04}, // '$'
+        {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}, // '%'
+        {0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D}, // '&'
+        {0x04, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00}, // '''
+        {0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02}, // '('
+        {0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08}, // ')'
+        {0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00}, // '*'
+        {0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00}, // '+'
+        {0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08}, // ','
+        {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}, // '-'
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}, // '.'
+        {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}, // '/'
+        {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}, // '0'
+        {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}, // '1'
+        {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}, // '2'
+        {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}, // '3'
+        {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}, // '4'
+        {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}, // '5'
+        {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}, // '6'
+        {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}, // '7'
+        {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}, // '8'
+        {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}, // '9'
+        {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}, // ':'
+        {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08}, // ';'
+        {0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02}, // '<'
+        {0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00}, // '='
+        {0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08}, // '>'
+        {0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04}, // '?'
+        {0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E}, // '@'
+        {0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}, // 'A'
+        {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}, // 'B'
+        {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}, // 'C'
+        {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}, // 'D'
+        {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}, // 'E'
+        {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}, // 'F'
+        {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}, // 'G'
+        {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}, // 'H'
+        {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}, // 'I'
+        {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}, // 'J'
+        {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}, // 'K'
+        {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}, // 'L'
+        {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}, // 'M'
+        {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}, // 'N'
+        {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // 'O'
+        {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}, // 'P'
+        {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}, // 'Q'
+        {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}, // 'R'
+        {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}, // 'S'
+        {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, // 'T'
+        {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // 'U'
+        {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}, // 'V'
+        {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}, // 'W'
+        {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}, // 'X'
+        {0x11, 0x11, 0x0A, 0x04, 0x04, 0x04, 0x04}, // 'Y'
+        {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}, // 'Z'
+        {0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E}, // '['
+        {0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00}, // '\'
+        {0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E}, // ']'
+        {0x04, 0x0A, 0x11, 0x00, 0x00, 0x00, 0x00}, // '^'
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F}, // '_'
+        {0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00}, // '`'
+        {0x00, 0x00, 0x0E, 0x01, 0x0F, 0x11, 0x0F}, // 'a'
+        {0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x1E}, // 'b'
+        {0x00, 0x00, 0x0E, 0x10, 0x10, 0x11, 0x0E}, // 'c'
+        {0x01, 0x01, 0x0D, 0x13, 0x11, 0x11, 0x0F}, // 'd'
+        {0x00, 0x00, 0x0E, 0x11, 0x1F, 0x10, 0x0E}, // 'e'
+        {0x06, 0x09, 0x08, 0x1C, 0x08, 0x08, 0x08}, // 'f'
+        {0x00, 0x0F, 0x11, 0x11, 0x0F, 0x01, 0x0E}, // 'g'
+        {0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x11}, // 'h'
+        {0x04, 0x00, 0x0C, 0x04, 0x04, 0x04, 0x0E}, // 'i'
+        {0x02, 0x00, 0x06, 0x02, 0x02, 0x12, 0x0C}, // 'j'
+        {0x10, 0x10, 0x12, 0x14, 0x18, 0x14, 0x12}, // 'k'
+        {0x0C, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}, // 'l'
+        {0x00, 0x00, 0x1A, 0x15, 0x15, 0x11, 0x11}, // 'm'
+        {0x00, 0x00, 0x16, 0x19, 0x11, 0x11, 0x11}, // 'n'
+        {0x00, 0x00, 0x0E, 0x11, 0x11, 0x11, 0x0E}, // 'o'
+        {0x00, 0x00, 0x1E, 0x11, 0x1E, 0x10, 0x10}, // 'p'
+        {0x00, 0x00, 0x0D, 0x13, 0x0F, 0x01, 0x01}, // 'q'
+        {0x00, 0x00, 0x16, 0x19, 0x10, 0x10, 0x10}, // 'r'
+        {0x00, 0x00, 0x0E, 0x10, 0x0E, 0x01, 0x1E}, // 's'
+        {0x08, 0x08, 0x1C, 0x08, 0x08, 0x09, 0x06}, // 't'
+        {0x00, 0x00, 0x11, 0x11, 0x11, 0x13, 0x0D}, // 'u'
+        {0x00, 0x00, 0x11, 0x11, 0x11, 0x0A, 0x04}, // 'v'
+        {0x00, 0x00, 0x11, 0x11, 0x15, 0x15, 0x0A}, // 'w'
+        {0x00, 0x00, 0x11, 0x0A, 0x04, 0x0A, 0x11}, // 'x'
+        {0x00, 0x00, 0x11, 0x11, 0x0F, 0x01, 0x0E}, // 'y'
+        {0x00, 0x00, 0x1F, 0x02, 0x04, 0x08, 0x1F}, // 'z'
+        {0x02, 0x04, 0x04, 0x08, 0x04, 0x04, 0x02}, // '{'
+        {0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, // '|'
+        {0x08, 0x04, 0x04, 0x02, 0x04, 0x04, 0x08}, // '}'
+        {0x00, 0x00, 0x08, 0x15, 0x02, 0x00, 0x00}, // '~'
+};
+
+static const int GLYPH_WIDTH = 5;
+static const int GLYPH_HEIGHT = 7;
+static const int BAND_HEIGHT = 32;
+
+struct ResolvedColor {
+    uint8_t red = 0;
+    uint8_t green = 0;
+    uint8_t blue = 0;
+    double opacity = 1.0;
+};
+
+// ------------------ Colors ------------------
+
+static std::optional<ResolvedColor> ResolveNamedColor(const std::string& name) {
+
+    if (name.empty() || name == "none"s || name == "transparent"s) {
+        return std::nullopt;
+    }
+
+    const bool is_hex = std::all_of(name.begin() + 1, name.end(), [](char c) {
+        return std::isxdigit(static_cast<unsigned char>(c)) != 0;
+    });
+    if (name[0] == '#' && (name.size() == 7 || name.size() == 4) && is_hex) {
+        const bool is_short = name.size() == 4;
+        auto component = [&](int index) {
+            std::string hex = is_short ? std::string(2, name[1 + index]) : name.substr(1 + 2 * index, 2);
+            return static_cast<uint8_t>(std::stoi(hex, nullptr, 16));
+        };
+        return ResolvedColor{component(0), component(1), component(2), 1.0};
+    }
+
+    static const std::unordered_map<std::string, ResolvedColor> named_colors = {
+            {"black"s, {0, 0, 0}},          {"white"s, {255, 255, 255}},
+            {"red"s, {255, 0, 0}},          {"green"s, {0, 128, 0}},
+            {"blue"s, {0, 0, 255}},         {"yellow"s, {255, 255, 0}},
+            {"orange"s, {255, 165, 0}},     {"purple"s, {128, 0, 128}},
+            {"brown"s, {165, 42, 42}},      {"gray"s, {128, 128, 128}},
+            {"grey"s, {128, 128, 128}},     {"pink"s, {255, 192, 203}},
+            {"cyan"s, {0, 255, 255}},       {"magenta"s, {255, 0, 255}},
+            {"lime"s, {0, 255, 0}},         {"navy"s, {0, 0, 128}},
+            {"maroon"s, {128, 0, 0}},       {"olive"s, {128, 128, 0}},
+            {"teal"s, {0, 128, 128}},       {"silver"s, {192, 192, 192}},
+            {"gold"s, {255, 215, 0}},       {"violet"s, {238, 130, 238}},
+            {"indigo"s, {75, 0, 130}},      {"coral"s, {255, 127, 80}},
+            {"salmon"s, {250, 128, 114}},   {"khaki"s, {240, 230, 140}},
+            {"crimson"s, {220, 20, 60}},    {"turquoise"s, {64, 224, 208}},
+            {"darkgreen"s, {0, 100, 0}},    {"darkblue"s, {0, 0, 139}},
+            {"darkred"s, {139, 0, 0}},      {"lightgray"s, {211, 211, 211}},
+            {"lightgrey"s, {211, 211, 211}},{"darkgray"s, {169, 169, 169}},
+            {"darkgrey"s, {169, 169, 169}},
+    };
+
+    auto it = named_colors.find(name);
+    if (it == named_colors.end()) {
+        // Unknown names and malformed hex are drawn black, the same fallback browsers use for invalid paint
+        return ResolvedColor{};
+    }
+    return it->second;
+}
+
+struct ColorResolver {
+
+    std::optional<ResolvedColor> operator()(std::monostate) const {
+        return std::nullopt;
+    }
+    std::optional<ResolvedColor> operator()(const std::string& color) const {
+        return ResolveNamedColor(color);
+    }
+    std::optional<ResolvedColor> operator()(svg::Rgb rgb_color) const {
+        return ResolvedColor{rgb_color.red, rgb_color.green, rgb_color.blue, 1.0};
+    }
+    std::optional<ResolvedColor> operator()(svg::Rgba rgba_color) const {
+        return ResolvedColor{rgba_color.red, rgba_color.green, rgba_color.blue,
+                             std::clamp(rgba_color.opacity, 0.0, 1.0)};
+    }
+};
+
+// ------------------ Primitives ------------------
+
+static double SignedDistance(const Canvas::Primitive& primitive, double x, double y) {
+
+    using Kind = Canvas::Primitive::Kind;
+
+    switch (primitive.kind) {
+        case Kind::SEGMENT : {
+            const double dx = primitive.b.x - primitive.a.x;
+            const double dy = primitive.b.y - primitive.a.y;
+            const double px = x - primitive.a.x;
+            const double py = y - primitive.a.y;
+            const double length_sq = dx * dx + dy * dy;
+            const double t = length_sq == 0 ? 0.0 : std::clamp((px * dx + py * dy) / length_sq, 0.0, 1.0);
+            return std::hypot(px - t * dx, py - t * dy) - primitive.radius;
+        }
+        case Kind::DISC :
+            return std::hypot(x - primitive.a.x, y - primitive.a.y) - primitive.radius;
+        case Kind::RING :
+            return std::abs(std::hypot(x - primitive.a.x, y - primitive.a.y) - primitive.radius) - primitive.b.x;
+        case Kind::BOX : {
+            const double dx = std::max({primitive.a.x - x, 0.0, x - primitive.b.x});
+            const double dy = std::max({primitive.a.y - y, 0.0, y - primitive.b.y});
+            if (dx > 0 || dy > 0) {
+                return std::hypot(dx, dy) - primitive.radius;
+            }
+            return -std::min({x - primitive.a.x, primitive.b.x - x, y - primitive.a.y, primitive.b.y - y})
+                   - primitive.radius;
+        }
+    }
+    return 0;
+}
+
+static void PrimitiveBounds(const Canvas::Primitive& primitive,
+                            double& min_x, double& min_y, double& max_x, double& max_y) {
+
+    using Kind = Canvas::Primitive::Kind;
+
+    double margin = primitive.radius + 1.0;
+    svg::Point low = primitive.a;
+    svg::Point high = primitive.a;
+
+    if (primitive.kind == Kind::SEGMENT || primitive.kind == Kind::BOX) {
+        low = {std::min(primitive.a.x, primitive.b.x), std::min(primitive.a.y, primitive.b.y)};
+        high = {std::max(primitive.a.x, primitive.b.x), std::max(primitive.a.y, primitive.b.y)};
+    }
+    if (primitive.kind == Kind::RING) {
+        margin += primitive.b.x;
+    }
+
+    min_x = low.x - margin;
+    min_y = low.y - margin;
+    max_x = high.x + margin;
+    max_y = high.y + margin;
+}
+
+// Adjacent fill boxes of one glyph must not leave a seam, so their coverage is summed.
+// Everything else overlaps (joints of a polyline, dilated boxes) and takes the maximum.
+static bool IsAdditive(const Canvas::Primitive& primitive) {
+    return primitive.kind == Canvas::Primitive::Kind::BOX && primitive.radius == 0;
+}
+
+// ------------------ Canvas ------------------
+
+void Canvas::AddPaint(Paint&& paint, const std::optional<svg::Color>& color) {
+
+    if (!color || paint.primitives.empty()) {
+        return;
+    }
+
+    auto resolved = std::visit(ColorResolver{}, *color);
+    if (!resolved || resolved->opacity <= 0) {
+        return;
+    }
+
+    paint.red = resolved->red;
+    paint.green = resolved->green;
+    paint.blue = resolved->blue;
+    paint.opacity = resolved->opacity;
+
+    PrimitiveBounds(paint.primitives.front(), paint.min_x, paint.min_y, paint.max_x, paint.max_y);
+    for (const auto& primitive : paint.primitives) {
+        double min_x, min_y, max_x, max_y;
+        PrimitiveBounds(primitive, min_x, min_y, max_x, max_y);
+        paint.min_x = std::min(paint.min_x, min_x);
+        paint.min_y = std::min(paint.min_y, min_y);
+        paint.max_x = std::max(paint.max_x, max_x);
+        paint.max_y = std::max(paint.max_y, max_y);
+    }
+
+    paints_.push_back(std::move(paint));
+}
+
+void Canvas::AddPtr(std::unique_ptr<svg::Object>&& obj) {
+
+    using Kind = Primitive::Kind;
+
+    if (const auto* polyline = dynamic_cast<const svg::Polyline*>(obj.get())) {
+
+        // Only the stroke is drawn, the renderer never fills route lines
+        const auto& points = polyline->GetPoints();
+        const double half_width = polyline->GetStrokeWidth().value_or(1.0) / 2;
+
+        Paint stroke;
+        for (size_t i = 0; i + 1 < points.size(); ++i) {
+            stroke.primitives.push_back({Kind::SEGMENT, points[i], points[i + 1], half_width});
+        }
+        if (points.size() == 1) {
+            stroke.primitives.push_back({Kind::SEGMENT, points[0], points[0], half_width});
+        }
+        AddPaint(std::move(stroke), polyline->GetStrokeColor());
+        return;
+    }
+
+    if (const auto* circle = dynamic_cast<const svg::Circle*>(obj.get())) {
+
+        Paint fill;
+        fill.primitives.push_back({Kind::DISC, circle->GetCenter(), {}, circle->GetRadius()});
+        AddPaint(std::move(fill), circle->GetFillColor());
+
+        Paint stroke;
+        stroke.primitives.push_back({Kind::RING, circle->GetCenter(),
+                                     {circle->GetStrokeWidth().value_or(1.0) / 2, 0}, circle->GetRadius()});
+        AddPaint(std::move(stroke), circle->GetStrokeColor());
+        return;
+    }
+
+    if (const auto* text = dynamic_cast<const svg::Text*>(obj.get())) {
+
+        // Cap height of the 5x7 font is 0.7 em, each glyph cell is followed by one empty column
+        const double scale = text->GetFontSize() * 0.7 / GLYPH_HEIGHT;
+        const bool is_bold = text->GetFontWeight() == "bold"s;
+        const double bold_extra = is_bold ? scale / 2 : 0.0;
+
+        double pen_x = text->GetPosition().x + text->GetOffset().x;
+        const double baseline = text->GetPosition().y + text->GetOffset().y;
+
+        std::vector<Primitive> boxes;
+
+        const std::string& data = text->GetData();
+        for (size_t index = 0; index < data.size(); ++index) {
+
+            const auto byte = static_cast<unsigned char>(data[index]);
+            if ((byte & 0xC0) == 0x80) {
+                continue; // UTF-8 continuation byte, the code point is already drawn
+            }
+
+            if (byte >= 0x20 && byte <= 0x7E) {
+                const auto& glyph = FONT_5X7[byte - 0x20];
+                for (int row = 0; row < GLYPH_HEIGHT; ++row) {
+                    const double top = baseline - (GLYPH_HEIGHT - row) * scale;
+                    int col = 0;
+                    while (col < GLYPH_WIDTH) {
+                        if ((glyph[row] & (0x10 >> col)) == 0) {
+                            ++col;
+                            continue;
+                        }
+                        int run_end = col;
+                        while (run_end < GLYPH_WIDTH && (glyph[row] & (0x10 >> run_end)) != 0) {
+                            ++run_end;
+                        }
+                        boxes.push_back({Kind::BOX,
+                                         {pen_x + col * scale, top},
+                                         {pen_x + run_end * scale + bold_extra, top + scale}, 0});
+                        col = run_end;
+                    }
+                }
+            } else if (byte >= 0x80) {
+                // No glyphs outside ASCII: a hollow box keeps the label length and position
+                const double top = baseline - GLYPH_HEIGHT * scale;
+                const double right = pen_x + GLYPH_WIDTH * scale + bold_extra;
+                boxes.push_back({Kind::BOX, {pen_x, top}, {right, top + scale}, 0});
+                boxes.push_back({Kind::BOX, {pen_x, baseline - scale}, {right, baseline}, 0});
+                boxes.push_back({Kind::BOX, {pen_x, top + scale}, {pen_x + scale, baseline - scale}, 0});
+                boxes.push_back({Kind::BOX, {right - scale, top + scale}, {right, baseline - scale}, 0});
+            }
+
+            pen_x += (GLYPH_WIDTH + 1) * scale + bold_extra;
+        }
+
+        Paint fill;
+        fill.primitives = boxes;
+        AddPaint(std::move(fill), text->GetFillColor());
+
+        // The outline is approximated by dilating every glyph box by half of the stroke width
+        Paint stroke;
+        const double half_width = text->GetStrokeWidth().value_or(1.0) / 2;
+        for (auto box : boxes) {
+            box.radius = half_width;
+            stroke.primitives.push_back(box);
+        }
+        AddPaint(std::move(stroke), text->GetStrokeColor());
+        return;
+    }
+}
+
+void Canvas::Append(Canvas&& other) {
+    paints_.insert(paints_.end(),
+                   std::make_move_iterator(other.paints_.begin()),
+                   std::make_move_iterator(other.paints_.end()));
+    other.paints_.clear();
+}
+
+void Canvas::RasterizeBand(Image& image, int row_begin, int row_end, std::vector<float>& coverage) const {
+
+    const int width = image.width;
+
+    for (const auto& paint : paints_) {
+
+        const int x_begin = std::max(0, static_cast<int>(std::floor(paint.min_x)));
+        const int x_end = std::min(width, static_cast<int>(std::ceil(paint.max_x)));
+        const int y_begin = std::max(row_begin, static_cast<int>(std::floor(paint.min_y)));
+        const int y_end = std::min(row_end, static_cast<int>(std::ceil(paint.max_y)));
+
+        if (x_begin >= x_end || y_begin >= y_end) {
+            continue;
+        }
+
+        for (int y = y_begin; y < y_end; ++y) {
+            std::fill_n(coverage.begin() + (y - row_begin) * width + x_begin, x_end - x_begin, 0.0f);
+        }
+
+        for (const auto& primitive : paint.primitives) {
+
+            double min_x, min_y, max_x, max_y;
+            PrimitiveBounds(primitive, min_x, min_y, max_x, max_y);
+
+            const int px_begin = std::max(x_begin, static_cast<int>(std::floor(min_x)));
+            const int px_end = std::min(x_end, static_cast<int>(std::ceil(max_x)));
+            const int py_begin = std::max(y_begin, static_cast<int>(std::floor(min_y)));
+            const int py_end = std::min(y_end, static_cast<int>(std::ceil(max_y)));
+
+            const bool is_additive = IsAdditive(primitive);
+
+            for (int y = py_begin; y < py_end; ++y) {
+                float* line = coverage.data() + (y - row_begin) * width;
+                for (int x = px_begin; x < px_end; ++x) {
+                    // Signed distance at the pixel center gives an exact coverage for straight edges
+                    const double distance = SignedDistance(primitive, x + 0.5, y + 0.5);
+                    const auto value = static_cast<float>(std::clamp(0.5 - distance, 0.0, 1.0));
+                    line[x] = is_additive ? std::min(1.0f, line[x] + value) : std::max(line[x], value);
+                }
+            }
+        }
+
+        for (int y = y_begin; y < y_end; ++y) {
+            const float* line = coverage.data() + (y - row_begin) * width;
+            uint8_t* pixel = image.pixels.data() + (static_cast<size_t>(y) * width + x_begin) * 3;
+            for (int x = x_begin; x < x_end; ++x, pixel += 3) {
+                const double alpha = line[x] * paint.opacity;
+                if (alpha <= 0) {
+                    continue;
+                }
+                pixel[0] = static_cast<uint8_t>(std::lround(pixel[0] + (paint.red - pixel[0]) * alpha));
+                pixel[1] = static_cast<uint8_t>(std::lround(pixel[1] + (paint.green - pixel[1]) * alpha));
+                pixel[2] = static_cast<uint8_t>(std::lround(pixel[2] + (paint.blue - pixel[2]) * alpha));
+            }
+        }
+    }
+}
+
+Image Canvas::Rasterize(int width, int height, size_t threads) const {
+
+    Image image(std::clamp(width, 1, MAX_IMAGE_SIDE), std::clamp(height, 1, MAX_IMAGE_SIDE));
+
+    const int band_count = (image.height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min(threads, static_cast<size_t>(band_count));
+
+    // Bands are handed out dynamically: bands crossing dense parts of the map take longer
+    std::atomic<int> next_band = 0;
+
+    auto worker = [&]() {
+        std::vector<float> coverage(static_cast<size_t>(image.width) * BAND_HEIGHT);
+        for (int band = next_band++; band < band_count; band = next_band++) {
+            const int row_begin = band * BAND_HEIGHT;
+            RasterizeBand(image, row_begin, std::min(image.height, row_begin + BAND_HEIGHT), coverage);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < threads; ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+
+    return image;
+}
+
+// ------------------ Encoders ------------------
+
+void WritePpm(const Image& image, std::ostream& output) {
+    output << "P6\n"sv << image.width << ' ' << image.height << "\n255\n"sv;
+    output.write(reinterpret_cast<const char*>(image.pixels.data()), static_cast<std::streamsize>(image.pixels.size()));
+}
+
+static uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+
+    static const auto table = []() {
+        std::array<uint32_t, 256> result{};
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            result[n] = c;
+        }
+        return result;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void AppendUint32(std::vector<uint8_t>& buffer, uint32_t value) {
+    buffer.push_back(static_cast<uint8_t>(value >> 24));
+    buffer.push_back(static_cast<uint8_t>(value >> 16));
+    buffer.push_back(static_cast<uint8_t>(value >> 8));
+    buffer.push_back(static_cast<uint8_t>(value));
+}
+
+static void WritePngChunk(std::ostream& output, std::string_view type, const std::vector<uint8_t>& data) {
+
+    std::vector<uint8_t> chunk;
+    chunk.reserve(data.size() + 12);
+    AppendUint32(chunk, static_cast<uint32_t>(data.size()));
+    chunk.insert(chunk.end(), type.begin(), type.end());
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    AppendUint32(chunk, Crc32(chunk.data() + 4, chunk.size() - 4));
+
+    output.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+}
+
+void WritePng(const Image& image, std::ostream& output) {
+
+    static const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    output.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+    std::vector<uint8_t> header;
+    AppendUint32(header, static_cast<uint32_t>(image.width));
+    AppendUint32(header, static_cast<uint32_t>(image.height));
+    header.insert(header.end(), {8, 2, 0, 0, 0}); // 8 bit depth, RGB, deflate, adaptive filter, no interlace
+    WritePngChunk(output, "IHDR"sv, header);
+
+    // Scanlines with filter type 0 (none)
+    const size_t row_size = static_cast<size_t>(image.width) * 3;
+    std::vector<uint8_t> raw;
+    raw.reserve((row_size + 1) * image.height);
+    for (int y = 0; y < image.height; ++y) {
+        raw.push_back(0);
+        raw.insert(raw.end(), image.pixels.begin() + y * row_size, image.pixels.begin() + (y + 1) * row_size);
+    }
+
+    // zlib stream made of stored deflate blocks
+    static const size_t MAX_BLOCK = 65535;
+    std::vector<uint8_t> zlib{0x78, 0x01};
+    zlib.reserve(raw.size() + raw.size() / MAX_BLOCK * 5 + 16);
+
+    size_t position = 0;
+    do {
+        const size_t block = std::min(MAX_BLOCK, raw.size() - position);
+        const bool is_final = position + block == raw.size();
+        zlib.push_back(is_final ? 1 : 0);
+        zlib.push_back(static_cast<uint8_t>(block));
+        zlib.push_back(static_cast<uint8_t>(block >> 8));
+        zlib.push_back(static_cast<uint8_t>(~block));
+        zlib.push_back(static_cast<uint8_t>(~block >> 8));
+        zlib.insert(zlib.end(), raw.begin() + position, raw.begin() + position + block);
+        position += block;
+    } while (position < raw.size());
+
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (uint8_t byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    AppendUint32(zlib, (b << 16) | a);
+
+    WritePngChunk(output, "IDAT"sv, zlib);
+    WritePngChunk(output, "IEND"sv, {});
+}
+
+void Write(const Image& image, Format format, std::ostream& output) {
+    switch (format) {
+        case Format::PNG :
+            WritePng(image, output);
+            break;
+        case Format::PPM :
+            WritePpm(image, output);
+            break;
+    }
+}
+
+std::string EncodeBase64(std::string_view data) {
+
+    static const std::string_view alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"sv;
+
+    std::string result;
+    result.reserve((data.size() + 2) / 3 * 4);
+
+    size_t index = 0;
+    for (; index + 2 < data.size(); index += 3) {
+        const uint32_t triple = (static_cast<uint8_t>(data[index]) << 16)
+                                | (static_cast<uint8_t>(data[index + 1]) << 8)
+                                | static_cast<uint8_t>(data[index + 2]);
+        result.push_back(alphabet[(triple >> 18) & 0x3F]);
+        result.push_back(alphabet[(triple >> 12) & 0x3F]);
+        result.push_back(alphabet[(triple >> 6) & 0x3F]);
+        result.push_back(alphabet[triple & 0x3F]);
+    }
+
+    if (index < data.size()) {
+        uint32_t triple = static_cast<uint8_t>(data[index]) << 16;
+        if (index + 1 < data.size()) {
+            triple |= static_cast<uint8_t>(data[index + 1]) << 8;
+        }
+        result.push_back(alphabet[(triple >> 18) & 0x3F]);
+        result.push_back(alphabet[(triple >> 12) & 0x3F]);
+        result.push_back(index + 1 < data.size() ? alphabet[(triple >> 6) & 0x3F] : '=');
+        result.push_back('=');
+    }
+
+    return result;
+}
+
+bool IsImageSizeSupported(double width, double height) {
+    // Written so that NaN is refused as well
+    return std::ceil(width) <= MAX_IMAGE_SIDE && std::ceil(height) <= MAX_IMAGE_SIDE;
+}
+
+std::optional<Format> ParseFormat(std::string_view name) {
+    if (name == "png"sv) {
+        return Format::PNG;
+    }
+    if (name == "ppm"sv) {
+        return Format::PPM;
+    }
+    return std::nullopt;
+}
+
+} // end namespace raster
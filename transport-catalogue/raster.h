@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "svg.h"
+
+namespace raster {
+
+enum class Format {
+    PNG,
+    PPM,
+};
+
+// ------------------ Image ------------------
+
+// 8-bit RGB bitmap, rows are stored top to bottom without padding
+struct Image {
+    Image(int image_width, int image_height)
+        : width(image_width), height(image_height), pixels(static_cast<size_t>(width) * height * 3, 255)
+    {
+    }
+
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+// Bitmaps larger than this along either side are refused before their pixels are allocated
+inline constexpr int MAX_IMAGE_SIDE = 8192;
+
+// Whether a picture of this size in pixels, rounded up, fits into MAX_IMAGE_SIDE
+bool IsImageSizeSupported(double width, double height);
+
+// ------------------ Canvas ------------------
+
+/*
+ * Canvas receives the same svg objects the map renderer adds to svg::Document,
+ * converts them to anti-aliased primitives and rasterizes them in horizontal
+ * bands which are processed by several threads. Each pixel is composited in
+ * the order the objects were added, so the result does not depend on the
+ * number of threads.
+ */
+class Canvas final : public svg::ObjectContainer {
+public:
+
+    void AddPtr(std::unique_ptr<svg::Object>&& obj) override;
+
+    // Moves all primitives of other canvas on top of this one
+    void Append(Canvas&& other);
+
+    // threads == 0 means std::thread::hardware_concurrency(), the sides are clamped to [1, MAX_IMAGE_SIDE]
+    [[nodiscard]] Image Rasterize(int width, int height, size_t threads = 0) const;
+
+    struct Primitive {
+        enum class Kind {
+            SEGMENT, // capsule around segment a-b with radius
+            DISC,    // disc centered at a with radius
+            RING,    // circle centered at a with radius and half width b.x
+            BOX,     // rectangle a-b dilated by radius
+        };
+
+        Kind kind;
+        svg::Point a;
+        svg::Point b;
+        double radius = 0;
+    };
+
+    struct Paint {
+        std::vector<Primitive> primitives;
+        uint8_t red = 0;
+        uint8_t green = 0;
+        uint8_t blue = 0;
+        double opacity = 1.0;
+
+        double min_x = 0;
+        double min_y = 0;
+        double max_x = 0;
+        double max_y = 0;
+    };
+
+private:
+    std::vector<Paint> paints_;
+
+    void AddPaint(Paint&& paint, const std::optional<svg::Color>& color);
+
+    void RasterizeBand(Image& image, int row_begin, int row_end, std::vector<float>& coverage) const;
+};
+
+// ------------------ Encoders ------------------
+
+// Binary P6 portable pixmap
+void WritePpm(const Image& image, std::ostream& output);
+
+// PNG with stored (uncompressed) deflate blocks, needs no external library
+void WritePng(const Image& image, std::ostream& output);
+
+void Write(const Image& image, Format format, std::ostream& output);
+
+std::string EncodeBase64(std::string_view data);
+
+std::optional<Format> ParseFormat(std::string_view name);
+
+} // end namespace raster
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "graph.h"
+#include "profile.h"
 
 #include <algorithm>
 #include <cassert>
@@ -63,16 +64,20 @@ private:
         }
     }
 
-    void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
+    // Returns the number of relaxation attempts
+    uint64_t RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
+        uint64_t relaxed = 0;
         for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
             if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
                 for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
                     if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
                         RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
+                        ++relaxed;
                     }
                 }
             }
         }
+        return relaxed;
     }
 
     static constexpr Weight ZERO_WEIGHT{};
@@ -89,9 +94,11 @@ Router<Weight>::Router(const Graph& graph)
     InitializeRoutesInternalData(graph);
 
     const size_t vertex_count = graph.GetVertexCount();
+    uint64_t relaxed = 0;
     for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-        RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+        relaxed += RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
     }
+    profile::Count("router.edges_relaxed", relaxed);
 }
 
 template <typename Weight>
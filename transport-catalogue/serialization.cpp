@@ -5,6 +5,11 @@
 #include <filesystem>
 #include <stdexcept>
 #include <algorithm>
+#include <cmath>
+#include <optional>
+#include <future>
+#include <type_traits>
+#include <utility>
 
 #include "transport_catalogue.h"
 
@@ -13,6 +18,7 @@
 #include "json.h"
 #include "json_reader.h"
 #include "map_renderer.h"
+#include "profile.h"
 
 using namespace std::literals;
 using namespace json;
@@ -51,11 +57,22 @@ namespace serial_database {
                 proto_route.add_stop_name(route.stops.at(index)->name);
             }
 
-            return std::move(proto_route);
+        } else {
+
+            for (const auto& stop : route.stops) {
+                proto_route.add_stop_name(stop->name);
+            }
         }
 
-        for (const auto& stop : route.stops) {
-            proto_route.add_stop_name(stop->name);
+        // Timetables are kept to a second, the departures as gaps between them to stay short varints
+        uint32_t previous = 0;
+        for (const double departure : route.departures) {
+            const auto seconds = static_cast<uint32_t>(std::llround(departure * 60.0));
+            proto_route.add_departure_delta(seconds - previous);
+            previous = seconds;
+        }
+        for (const double run_time : route.run_times) {
+            proto_route.add_run_time(static_cast<uint32_t>(std::llround(run_time * 60.0)));
         }
 
         return std::move(proto_route);
@@ -131,6 +148,10 @@ namespace serial_database {
             *settings.add_color_palette() = SerializeColor(i);
         }
 
+        if (json_settings.count("simplification_tolerance"s) != 0) {
+            settings.set_simplification_tolerance(json_settings.at("simplification_tolerance"s).AsDouble());
+        }
+
         return settings;
     }
 
@@ -140,8 +161,11 @@ namespace serial_database {
 
         const auto all_stops_ptr = catalogue.GetConstStopsPtr();
 
+        // Stop ids are positions in all_stops, so the ids after removed stops shift down
         for (const auto &stop: *all_stops_ptr) {
-            *full_data.add_all_stops() = SerializeStop(stop);
+            if (!catalogue.IsStopRemoved(stop.id)) {
+                *full_data.add_all_stops() = SerializeStop(stop);
+            }
         }
 
         const auto all_distances_ptr = catalogue.GetConstDistancesPtr();
@@ -153,7 +177,9 @@ namespace serial_database {
         const auto all_routes_ptr = catalogue.GetConstRoutePtr();
 
         for (const auto &route: *all_routes_ptr) {
-            *full_data.add_all_routes() = SerializeRoute(route);
+            if (!catalogue.IsRouteRemoved(route.id)) {
+                *full_data.add_all_routes() = SerializeRoute(route);
+            }
         }
 
         return full_data;
@@ -168,8 +194,14 @@ namespace serial_database {
         return router_settings;
     }
 
+    // Runs the task on its own thread if parallel is set, in place otherwise
+    template <typename Func>
+    static std::future<std::invoke_result_t<Func>> RunStage(bool parallel, Func&& func) {
+        return std::async(parallel ? std::launch::async : std::launch::deferred, std::forward<Func>(func));
+    }
+
     proto_router::Router SerialRouter(transport_catalogue::TransportCatalogue& catalogue,
-                                                       proto_router::RoutingSetting&& settings) {
+                                      proto_router::RoutingSetting&& settings, bool parallel) {
 
         proto_router::Router router;
 
@@ -181,35 +213,128 @@ namespace serial_database {
 
         *router.mutable_routing_settings() = std::move(settings);
 
-        for (const auto& edge : ref.get()->GetGraph().GetEdgesRef()) {
-            proto_graph::Edge proto_edge;
-            proto_edge.set_vertex_id_from(edge.from);
-            proto_edge.set_vertex_id_to(edge.to);
-            proto_edge.set_weight(edge.weight);
-            *router.add_edges() = proto_edge;
+        // Vertices follow the stop ids written by SerializeCatalogueData, removed stops have no edges
+        const auto vertex_count = ref.get()->GetGraph().GetVertexCount();
+        std::vector<graph::VertexId> new_vertex_ids(vertex_count);
+        graph::VertexId next_vertex_id = 0;
+        for (graph::VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            new_vertex_ids[vertex] = next_vertex_id;
+            if (!catalogue.IsStopRemoved(static_cast<int>(vertex))) {
+                ++next_vertex_id;
+            }
         }
 
-        for (const auto& line : ref.get()->GetGraph().GetIncidenceListsRef()) {
-            proto_graph::IncidenceList list;
-
-            for (const auto& edge_id : line) {
-                list.add_edge_id(edge_id);
+        // The sections are independent, every one is encoded into its own message and moved in afterwards
+        auto edges_section = RunStage(parallel, [&] {
+            proto_router::Router section;
+            section.mutable_edges()->Reserve(static_cast<int>(ref.get()->GetGraph().GetEdgeCount()));
+            for (const auto& edge : ref.get()->GetGraph().GetEdgesRef()) {
+                auto& proto_edge = *section.add_edges();
+                proto_edge.set_vertex_id_from(new_vertex_ids[edge.from]);
+                proto_edge.set_vertex_id_to(new_vertex_ids[edge.to]);
+                proto_edge.set_weight(edge.weight);
             }
+            return section;
+        });
+
+        auto incidence_section = RunStage(parallel, [&] {
+            proto_router::Router section;
+            for (graph::VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+                if (catalogue.IsStopRemoved(static_cast<int>(vertex))) {
+                    continue;
+                }
+                const auto& line = ref.get()->GetGraph().GetIncidenceListsRef()[vertex];
+                auto& list = *section.add_incidence_lists();
+                for (const auto& edge_id : line) {
+                    list.add_edge_id(edge_id);
+                }
+            }
+            return section;
+        });
+
+        auto info_section = RunStage(parallel, [&] {
+            proto_router::Router section;
+            const auto& all_info = ref.get()->GetAllPathInfo();
+            for (graph::EdgeId edge_id = 0; edge_id < all_info.size(); ++edge_id) {
+                const auto& path_info = all_info[edge_id];
+                if (path_info.route_ptr == nullptr) {
+                    continue;
+                }
+                auto& info = *section.add_all_info();
+                info.set_edge_id(edge_id);
+                info.set_route_name(path_info.route_ptr->name);
+                info.set_stop_name(path_info.from->name);
+                info.set_span(path_info.span);
+                info.set_from_index(path_info.from_index);
+                info.set_to_index(path_info.to_index);
+            }
+            return section;
+        });
+
+        // Landmarks are picked on the graph as it is, their vertices and arrays follow the new vertex ids
+        auto landmarks_section = RunStage(parallel, [&] {
+            profile::ScopedTimer timer("router.select_landmarks"sv);
+            const auto bounds = graph::LandmarkBounds<double>::Select(ref.get()->GetGraph(),
+                                                                      transport_catalogue::TransportRouter::LANDMARK_COUNT);
+            const size_t count = bounds.GetLandmarks().size();
+
+            proto_router::Router section;
+            auto& landmarks = *section.mutable_landmarks();
+            for (const auto vertex : bounds.GetLandmarks()) {
+                landmarks.add_vertex_id(new_vertex_ids[vertex]);
+            }
+            landmarks.mutable_forward()->Reserve(static_cast<int>(next_vertex_id * count));
+            landmarks.mutable_backward()->Reserve(static_cast<int>(next_vertex_id * count));
+            for (graph::VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+                if (catalogue.IsStopRemoved(static_cast<int>(vertex))) {
+                    continue;
+                }
+                for (size_t index = 0; index < count; ++index) {
+                    landmarks.add_forward(bounds.GetForward()[vertex * count + index]);
+                    landmarks.add_backward(bounds.GetBackward()[vertex * count + index]);
+                }
+            }
+            return section;
+        });
 
-            *router.add_incidence_lists() = list;
-        }
+        router.mutable_edges()->Swap(edges_section.get().mutable_edges());
+        router.mutable_incidence_lists()->Swap(incidence_section.get().mutable_incidence_lists());
+        router.mutable_all_info()->Swap(info_section.get().mutable_all_info());
+        router.mutable_landmarks()->Swap(landmarks_section.get().mutable_landmarks());
 
-        for (const auto& [edge_id, path_info] : ref.get()->GetAllPathInfo()) {
-            proto_router::PathInfo info;
-            info.set_edge_id(edge_id);
-            info.set_route_name(path_info.route_ptr->name);
-            info.set_stop_name(path_info.from->name);
-            info.set_span(path_info.span);
+        return router;
+    }
 
-            *router.add_all_info() = std::move(info);
-        }
+    proto_catalogue::TransportCatalogue BuildBase(transport_catalogue::TransportCatalogue& catalogue,
+                                                  const transport_catalogue::RouterSettings& routing_settings,
+                                                  const Dict& render_settings, bool parallel) {
 
-        return router;
+        profile::ScopedTimer build_timer("make_base.build"sv);
+
+        // The catalogue is only read from here on, the router task is the only one which changes it
+        auto router_stage = RunStage(parallel, [&] {
+            profile::ScopedTimer router_timer("make_base.router_build"sv);
+            catalogue.CreateRouter(routing_settings);
+            router_timer.Stop();
+
+            profile::ScopedTimer serialize_timer("make_base.serialize_router"sv);
+            return SerialRouter(catalogue, SerialRoutingSetting(routing_settings), parallel);
+        });
+
+        auto catalogue_stage = RunStage(parallel, [&] {
+            profile::ScopedTimer timer("make_base.serialize_catalogue"sv);
+            return SerializeCatalogueData(catalogue);
+        });
+
+        profile::ScopedTimer render_timer("make_base.serialize_render_settings"sv);
+        auto serial_render_settings = SerialRenderSetting(render_settings);
+        render_timer.Stop();
+
+        auto data = catalogue_stage.get();
+        *data.mutable_router() = router_stage.get();
+        *data.mutable_render_settings() = std::move(serial_render_settings);
+
+        return data;
     }
 
     bool MakeBase(std::istream& input) {
@@ -219,9 +344,13 @@ namespace serial_database {
 
         JsonReader reader(&catalogue);
 
+        profile::ScopedTimer parse_timer("make_base.parse"sv);
         reader.ReadJSON(input);
+        parse_timer.Stop();
 
+        profile::ScopedTimer fill_timer("make_base.fill_catalogue"sv);
         reader.FillCatalogue();
+        fill_timer.Stop();
 
         // Filling proto object :
         auto doc = reader.GetJSONDocument();
@@ -231,20 +360,8 @@ namespace serial_database {
         auto routing_settings = RouterSettingsFromJSON(
                 doc.GetRoot().AsDict().at("routing_settings"s).AsDict());
 
-        catalogue.CreateRouter(routing_settings);
-
-        auto data = SerializeCatalogueData(catalogue);
-
-        auto render_settings = SerialRenderSetting(
-                doc.GetRoot().AsDict().at("render_settings"s).AsDict());
-
-        auto serial_routing_settings = SerialRoutingSetting(routing_settings);
-
-        auto serial_router = SerialRouter(catalogue, std::move(serial_routing_settings));
-
-        *data.mutable_router() = std::move(serial_router);
-
-        *data.mutable_render_settings() = std::move(render_settings);
+        auto data = BuildBase(catalogue, routing_settings,
+                              doc.GetRoot().AsDict().at("render_settings"s).AsDict(), true);
 
         // Write to file part :
         std::ofstream out_file(file_name, std::ios::binary);
@@ -254,13 +371,18 @@ namespace serial_database {
         }
 
         // only one write sys calling;
+        profile::ScopedTimer write_timer("make_base.write"sv);
         data.SerializePartialToOstream(&out_file);
+        write_timer.Stop();
+        profile::Count("io.base_bytes_written"sv, data.ByteSizeLong());
 
         return true;
 
     }
 
-    void FillCatalogue(const proto_catalogue::TransportCatalogue& data, transport_catalogue::TransportCatalogue& catalogue) {
+    // The catalogue sections are the same in TransportCatalogue and TransportCatalogueSections
+    template <typename BaseData>
+    static void FillCatalogueSections(const BaseData& data, transport_catalogue::TransportCatalogue& catalogue) {
 
         for (auto index = 0; index < data.all_stops_size(); ++index) {
             catalogue.AddStop(data.all_stops(index).name(),
@@ -293,9 +415,33 @@ namespace serial_database {
             catalogue.AddRoute(data.all_routes(route_index).name(),
                                stops_str,
                                data.all_routes(route_index).is_roundtrip());
+
+            const auto& proto_route = data.all_routes(route_index);
+            if (proto_route.departure_delta_size() != 0) {
+                std::vector<double> departures;
+                uint32_t seconds = 0;
+                for (const auto delta : proto_route.departure_delta()) {
+                    seconds += delta;
+                    departures.push_back(seconds / 60.0);
+                }
+                std::vector<double> run_times;
+                for (const auto run_time : proto_route.run_time()) {
+                    run_times.push_back(run_time / 60.0);
+                }
+                catalogue.SetTimetable(proto_route.name(), std::move(departures), std::move(run_times));
+            }
         }
     }
 
+    void FillCatalogue(const proto_catalogue::TransportCatalogue& data, transport_catalogue::TransportCatalogue& catalogue) {
+        FillCatalogueSections(data, catalogue);
+    }
+
+    void FillCatalogue(const proto_catalogue::TransportCatalogueSections& data,
+                       transport_catalogue::TransportCatalogue& catalogue) {
+        FillCatalogueSections(data, catalogue);
+    }
+
     proto_catalogue::TransportCatalogue DeserializeFile(std::istream& file) {
 
         proto_catalogue::TransportCatalogue data;
@@ -359,6 +505,8 @@ namespace serial_database {
             settings.color_palette.push_back(DeserializeColor(i));
         }
 
+        settings.simplification_tolerance = data.render_settings().simplification_tolerance();
+
         return settings;
     }
 
@@ -395,24 +543,120 @@ namespace serial_database {
                                                             proto_router.routing_settings().bus_velocity_()
                                                             };
 
-        std::unordered_map<graph::EdgeId, transport_catalogue::PathInfo> all_info;
+        std::vector<transport_catalogue::PathInfo> all_info(proto_router.edges_size());
 
         for (const auto& item : proto_router.all_info()) {
-            all_info[item.edge_id()] = transport_catalogue::PathInfo{
+            all_info.at(item.edge_id()) = transport_catalogue::PathInfo{
                 catalogue.GetRoutePtr(item.route_name()),
                 catalogue.GetStopPtr(item.stop_name()),
-                int(item.span())};
+                int(item.span()),
+                int(item.from_index()),
+                int(item.to_index())};
         }
 
         catalogue.CreateRouterFromProto(std::move(router_settings), std::move(graph), std::move(all_info));
 
+        // Bases written before the landmarks were added have none, A* then uses the geographic bounds only
+        const auto& landmarks = proto_router.landmarks();
+        if (landmarks.vertex_id_size() != 0) {
+            catalogue.GetRouter()->SetLandmarks(graph::LandmarkBounds<double>(
+                    {landmarks.vertex_id().begin(), landmarks.vertex_id().end()},
+                    {landmarks.forward().begin(), landmarks.forward().end()},
+                    {landmarks.backward().begin(), landmarks.backward().end()}));
+        }
+
+    }
+
+    bool UpdateBase(std::istream& input) {
+
+        transport_catalogue::TransportCatalogue catalogue;
+        JsonReader reader(&catalogue);
+
+        profile::ScopedTimer parse_timer("update_base.parse"sv);
+        reader.ReadJSON(input);
+        parse_timer.Stop();
+
+        const auto& file_settings = reader.GetJSONDocument().GetRoot().AsDict().at("serialization_settings"s).AsDict();
+        const auto& file_name = file_settings.at("file"s).AsString();
+        const auto& output_file_name = file_settings.count("output_file"s) != 0
+                                       ? file_settings.at("output_file"s).AsString() : file_name;
+
+        std::ifstream in_file(file_name, std::ios::binary);
+        if (!in_file) {
+            std::cout << "Input_file_open_error"s << std::endl;
+            return false;
+        }
+
+        // The router is decoded and encoded again only if the changes reach its edges or vertices,
+        // otherwise its section is written back as it was read, and so are the render settings
+        profile::ScopedTimer read_timer("update_base.read_base"sv);
+        proto_catalogue::TransportCatalogueSections data;
+        data.ParseFromIstream(&in_file);
+        in_file.close();
+        FillCatalogue(data, catalogue);
+        read_timer.Stop();
+
+        bool router_changes = false;
+        proto_router::RoutingSetting routing_settings;
+        try {
+            router_changes = reader.UpdatesChangeRouter();
+        } catch (const std::exception& error) {
+            std::cerr << "Unable to apply the update: "sv << error.what() << std::endl;
+            return false;
+        }
+        if (router_changes) {
+            profile::ScopedTimer router_timer("update_base.read_router"sv);
+            proto_router::Router router;
+            router.ParseFromString(data.router());
+            DeserializeRouter(catalogue, router);
+            routing_settings = std::move(*router.mutable_routing_settings());
+        }
+
+        // Only the routes touched by the changes get new router edges
+        profile::ScopedTimer apply_timer("update_base.apply"sv);
+        try {
+            reader.ApplyUpdates();
+        } catch (const std::exception& error) {
+            std::cerr << "Unable to apply the update: "sv << error.what() << std::endl;
+            return false;
+        }
+        if (router_changes) {
+            catalogue.CompactRouter();
+        }
+        apply_timer.Stop();
+
+        profile::ScopedTimer serialize_timer("update_base.serialize"sv);
+        auto catalogue_data = SerializeCatalogueData(catalogue);
+        data.mutable_all_stops()->Swap(catalogue_data.mutable_all_stops());
+        data.mutable_all_distances()->Swap(catalogue_data.mutable_all_distances());
+        data.mutable_all_routes()->Swap(catalogue_data.mutable_all_routes());
+        if (router_changes) {
+            SerialRouter(catalogue, std::move(routing_settings), true).SerializeToString(data.mutable_router());
+        }
+        serialize_timer.Stop();
+
+        std::ofstream out_file(output_file_name, std::ios::binary);
+        if (!out_file) {
+            std::cout << "Out_file_open_error"s << std::endl;
+            return false;
+        }
+
+        profile::ScopedTimer write_timer("update_base.write"sv);
+        data.SerializePartialToOstream(&out_file);
+        write_timer.Stop();
+        profile::Count("io.base_bytes_written"sv, data.ByteSizeLong());
+
+        return true;
     }
 
-    bool ProcessRequests(std::istream& input, std::ostream& output) {
+    bool ProcessRequests(std::istream& input, std::ostream& output, std::ostream* capture_output) {
 
         transport_catalogue::TransportCatalogue catalogue;
         JsonReader reader(&catalogue);
+
+        profile::ScopedTimer parse_timer("process_requests.parse"sv);
         reader.ReadJSON(input);
+        parse_timer.Stop();
 
         auto doc = reader.GetJSONDocument();
 
@@ -424,16 +668,40 @@ namespace serial_database {
             return false;
         }
 
+        profile::ScopedTimer read_timer("process_requests.read_base"sv);
         auto proto_catalogue = DeserializeFile(in_file);
+        read_timer.Stop();
+        profile::Count("io.base_bytes_read"sv, proto_catalogue.ByteSizeLong());
 
+        profile::ScopedTimer fill_timer("process_requests.fill_catalogue"sv);
         FillCatalogue(proto_catalogue, catalogue);
+        fill_timer.Stop();
 
+        profile::ScopedTimer render_settings_timer("process_requests.render_settings"sv);
         reader.SetRenderSettings(DeserializeRenderSettings(proto_catalogue));
+        render_settings_timer.Stop();
 
+        profile::ScopedTimer router_timer("process_requests.deserialize_router"sv);
         DeserializeRouter(catalogue, proto_catalogue.router());
+        router_timer.Stop();
 
+        std::optional<query_log::Capture> capture;
+        if (capture_output != nullptr) {
+            reader.SetCapture(&capture.emplace());
+        }
+
+        profile::ScopedTimer requests_timer("process_requests.requests"sv);
         reader.ProcessRequests();
+        requests_timer.Stop();
+
+        if (capture) {
+            reader.SetCapture(nullptr);
+            capture->Write(*capture_output, doc.GetRoot().AsDict().at("serialization_settings"s).AsDict());
+        }
+
+        profile::ScopedTimer print_timer("process_requests.print"sv);
         reader.PrintResponses(output);
+        print_timer.Stop();
 
         return true;
     }
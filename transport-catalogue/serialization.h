@@ -30,20 +30,42 @@ namespace serial_database {
 
     static inline proto_svg::Color SerializeColor(const Node& json_color);
 
-    static inline proto_renderer::RenderSetting SerialRenderSetting(const Dict& json_settings);
+    proto_renderer::RenderSetting SerialRenderSetting(const Dict& json_settings);
 
-    static inline proto_catalogue::TransportCatalogue SerializeCatalogueData(
+    proto_catalogue::TransportCatalogue SerializeCatalogueData(
             const transport_catalogue::TransportCatalogue& catalogue);
 
-    static inline proto_router::RoutingSetting SerialRoutingSetting(const Dict& json_settings);
+    transport_catalogue::RouterSettings RouterSettingsFromJSON(const Dict& json_settings);
 
-    static inline proto_router::Router SerialRouter(const Dict& json_settings);
+    proto_router::RoutingSetting SerialRoutingSetting(const transport_catalogue::RouterSettings& settings);
+
+    //  throws std::runtime_error if the router is not created in catalogue
+    //  with parallel set the edges, incidence lists and path info are encoded on separate threads
+    proto_router::Router SerialRouter(transport_catalogue::TransportCatalogue& catalogue,
+                                      proto_router::RoutingSetting&& settings, bool parallel = false);
+
+    //  builds the router and the whole base of a filled catalogue. With parallel set the router
+    //  (graph construction, then its encoding) and the catalogue sections are built concurrently,
+    //  the result is the same as of the sequential build.
+    proto_catalogue::TransportCatalogue BuildBase(transport_catalogue::TransportCatalogue& catalogue,
+                                                  const transport_catalogue::RouterSettings& routing_settings,
+                                                  const Dict& render_settings, bool parallel = true);
 
     void FillCatalogue(const proto_catalogue::TransportCatalogue& data,
                        transport_catalogue::TransportCatalogue& catalogue);
 
+    void FillCatalogue(const proto_catalogue::TransportCatalogueSections& data,
+                       transport_catalogue::TransportCatalogue& catalogue);
+
     bool MakeBase(std::istream& input);
 
+    // Reads the base of serialization_settings.file, applies base_requests as changes
+    // (see JsonReader::ApplyUpdates) and writes the result to serialization_settings.output_file,
+    // to the same file if it is not given. The router is decoded only if the changes reach its graph
+    // (see JsonReader::UpdatesChangeRouter), then the edges of the changed routes are rebuilt and the
+    // landmarks picked again. Otherwise only the catalogue sections are decoded and encoded again.
+    bool UpdateBase(std::istream& input);
+
     // ----------- Deserialize functions --------------------------------
 
     proto_catalogue::TransportCatalogue DeserializeFile(std::istream& file);
@@ -54,6 +76,7 @@ namespace serial_database {
     void DeserializeRouter(transport_catalogue::TransportCatalogue& catalogue,
                            const proto_router::Router& proto_router);
 
-    bool ProcessRequests(std::istream& input, std::ostream& output);
+    // Writes the processed stat_requests with their timing to capture_output if it is given
+    bool ProcessRequests(std::istream& input, std::ostream& output, std::ostream* capture_output = nullptr);
 
 } // end namespace serial_database
\ No newline at end of file
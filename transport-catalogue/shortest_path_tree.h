@@ -0,0 +1,195 @@
+#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Dijkstra search from one vertex. The per-vertex arrays are sized once and reused by the next
+// searches: a label is valid only if its stamp equals the number of the current search, so a search
+// touches just the vertices it reaches instead of resetting V-sized arrays.
+template <typename Weight>
+class ShortestPathTree {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    explicit ShortestPathTree(const Graph& graph)
+        : graph_(graph)
+    {
+    }
+
+    // Weight of the edge as it is stored in the graph
+    struct StoredWeight {
+        Weight operator()(EdgeId, const Edge<Weight>& edge) const {
+            return edge.weight;
+        }
+    };
+
+    // Settles vertices in the order of their distance from the source. Stops as soon as all
+    // the targets are settled, with no targets the whole reachable part of the graph is settled.
+    // Vertices farther than max_weight are never settled. edge_weight(edge_id, edge) may replace
+    // the weights of the graph for this search, e.g. to penalize some edges.
+    template <typename EdgeWeight = StoredWeight>
+    void Build(VertexId source, const std::vector<VertexId>& targets = {},
+               Weight max_weight = std::numeric_limits<Weight>::max(), EdgeWeight edge_weight = {});
+
+    VertexId GetSource() const {
+        return source_;
+    }
+
+    // Only settled vertices have their final weight
+    bool IsSettled(VertexId vertex) const {
+        return vertex < states_.size() && states_[vertex].settled == stamp_;
+    }
+
+    Weight GetWeight(VertexId vertex) const {
+        return states_[vertex].weight;
+    }
+
+    // Last edge of the path to a settled vertex, nullopt for the source
+    std::optional<EdgeId> GetPrevEdge(VertexId vertex) const {
+        const auto edge_id = states_[vertex].prev_edge;
+        return edge_id == NO_EDGE ? std::nullopt : std::optional<EdgeId>(edge_id);
+    }
+
+    // Edges of the path from the source, nullopt if the vertex is not settled
+    std::optional<std::vector<EdgeId>> GetPathEdges(VertexId vertex) const;
+
+    // Vertices settled by the last search in the order of their weights
+    const std::vector<VertexId>& GetSettledVertices() const {
+        return settled_;
+    }
+
+    uint64_t GetSettledCount() const {
+        return settled_.size();
+    }
+
+private:
+    static constexpr EdgeId NO_EDGE = Graph::REMOVED_EDGE;
+
+    struct VertexState {
+        Weight weight{};
+        EdgeId prev_edge = NO_EDGE;
+        uint32_t labelled = 0;
+        uint32_t settled = 0;
+        uint32_t target = 0;
+    };
+
+    const Graph& graph_;
+    std::vector<VertexState> states_;
+    std::vector<std::pair<Weight, VertexId>> heap_;
+    uint32_t stamp_ = 0;
+    VertexId source_ = 0;
+    std::vector<VertexId> settled_;
+
+    void StartSearch();
+};
+
+template <typename Weight>
+void ShortestPathTree<Weight>::StartSearch() {
+
+    // The graph may get vertices between the searches
+    if (states_.size() < graph_.GetVertexCount()) {
+        states_.resize(graph_.GetVertexCount());
+    }
+
+    if (++stamp_ == 0) {
+        // The stamps wrapped around, old labels could look valid again
+        std::fill(states_.begin(), states_.end(), VertexState{});
+        stamp_ = 1;
+    }
+
+    heap_.clear();
+    settled_.clear();
+}
+
+template <typename Weight>
+template <typename EdgeWeight>
+void ShortestPathTree<Weight>::Build(VertexId source, const std::vector<VertexId>& targets, Weight max_weight,
+                                     EdgeWeight edge_weight) {
+
+    StartSearch();
+    source_ = source;
+
+    size_t targets_left = 0;
+    for (const VertexId target : targets) {
+        if (states_.at(target).target != stamp_) {
+            states_[target].target = stamp_;
+            ++targets_left;
+        }
+    }
+    const bool is_bounded_by_targets = targets_left != 0;
+
+    const auto heap_order = std::greater<std::pair<Weight, VertexId>>{};
+
+    states_.at(source) = VertexState{Weight{}, NO_EDGE, stamp_, 0, states_[source].target};
+    heap_.emplace_back(Weight{}, source);
+
+    while (!heap_.empty()) {
+        std::pop_heap(heap_.begin(), heap_.end(), heap_order);
+        const auto [weight, vertex] = heap_.back();
+        heap_.pop_back();
+
+        auto& state = states_[vertex];
+        if (state.settled == stamp_ || weight > state.weight) {
+            continue;
+        }
+        if (weight > max_weight) {
+            break;
+        }
+        state.settled = stamp_;
+        settled_.push_back(vertex);
+
+        if (is_bounded_by_targets && state.target == stamp_ && --targets_left == 0) {
+            break;
+        }
+
+        for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const Weight length = edge_weight(edge_id, edge);
+            if (length < Weight{}) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+
+            auto& next = states_[edge.to];
+            const Weight candidate = weight + length;
+            if (candidate > max_weight) {
+                continue;
+            }
+            if (next.labelled != stamp_ || candidate < next.weight) {
+                next.weight = candidate;
+                next.prev_edge = edge_id;
+                next.labelled = stamp_;
+                heap_.emplace_back(candidate, edge.to);
+                std::push_heap(heap_.begin(), heap_.end(), heap_order);
+            }
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<std::vector<EdgeId>> ShortestPathTree<Weight>::GetPathEdges(VertexId vertex) const {
+
+    if (!IsSettled(vertex)) {
+        return std::nullopt;
+    }
+
+    std::vector<EdgeId> edges;
+    for (auto edge_id = GetPrevEdge(vertex); edge_id; edge_id = GetPrevEdge(graph_.GetEdge(*edge_id).from)) {
+        edges.push_back(*edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return edges;
+}
+
+} // namespace graph
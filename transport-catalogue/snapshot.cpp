@@ -0,0 +1,233 @@
+#include "snapshot.h"
+
+#include <fstream>
+#include <stdexcept>
+
+#include "json.h"
+#include "json_builder.h"
+#include "json_reader.h"
+#include "profile.h"
+#include "serialization.h"
+
+using namespace std::literals;
+
+namespace serial_database {
+
+std::shared_ptr<CatalogueSnapshot> LoadSnapshot(const std::string& file, uint64_t version) {
+
+    profile::ScopedTimer timer("serve.load_snapshot"sv);
+
+    std::ifstream in_file(file, std::ios::binary);
+    if (!in_file) {
+        throw std::runtime_error("Unable to open base "s + file);
+    }
+    const auto data = DeserializeFile(in_file);
+
+    auto snapshot = std::make_shared<CatalogueSnapshot>();
+    snapshot->file = file;
+    snapshot->version = version;
+    FillCatalogue(data, snapshot->catalogue);
+    snapshot->render_settings = DeserializeRenderSettings(data);
+    DeserializeRouter(snapshot->catalogue, data.router());
+
+    // Lazy parts (route statistics are cached by SearchRoute) are built here, on the loading thread
+    auto& catalogue = snapshot->catalogue;
+    if (!catalogue.GetConstStopsPtr()->empty()) {
+        catalogue.GetRouter()->BuildRoute(0, 0);
+    }
+    for (const auto& [name, route_ptr] : catalogue.GetAllRoutesPtr()) {
+        static_cast<void>(catalogue.SearchRoute(name));
+    }
+
+    return snapshot;
+}
+
+// ------------------ SnapshotHolder ------------------
+
+SnapshotHolder::SnapshotHolder(std::shared_ptr<CatalogueSnapshot> initial)
+    : current_(std::move(initial)), last_version_(current_->version)
+{
+    worker_ = std::thread([this] { RunTasks(); });
+}
+
+SnapshotHolder::~SnapshotHolder() {
+    {
+        std::lock_guard guard(mutex_);
+        is_stopping_ = true;
+    }
+    has_tasks_.notify_one();
+    worker_.join();
+}
+
+std::shared_ptr<CatalogueSnapshot> SnapshotHolder::Get() const {
+    return std::atomic_load(&current_);
+}
+
+uint64_t SnapshotHolder::ReloadAsync(std::string file) {
+
+    uint64_t version = 0;
+    {
+        std::lock_guard guard(mutex_);
+        if (is_loading_) {
+            return 0;
+        }
+        is_loading_ = true;
+        version = ++last_version_;
+    }
+
+    AddTask([this, file = std::move(file), version] {
+        std::string error_message;
+        try {
+            std::atomic_store(&current_, LoadSnapshot(file, version));
+        } catch (const std::exception& error) {
+            error_message = "Reload of "s + file + " failed: "s + error.what();
+            std::cerr << error_message << std::endl;
+        }
+        std::lock_guard guard(mutex_);
+        is_loading_ = false;
+        failed_version_ = error_message.empty() ? 0 : version;
+        last_error_ = std::move(error_message);
+    });
+
+    return version;
+}
+
+ReloadStatus SnapshotHolder::GetReloadStatus() const {
+    ReloadStatus status;
+    status.current_version = Get()->version;
+    std::lock_guard guard(mutex_);
+    status.is_loading = is_loading_;
+    status.failed_version = failed_version_;
+    status.error = last_error_;
+    return status;
+}
+
+void SnapshotHolder::Retire(std::shared_ptr<CatalogueSnapshot> snapshot) {
+    AddTask([snapshot = std::move(snapshot)]() mutable {
+        snapshot.reset();
+    });
+}
+
+void SnapshotHolder::AddTask(std::function<void()> task) {
+    {
+        std::lock_guard guard(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    has_tasks_.notify_one();
+}
+
+void SnapshotHolder::RunTasks() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex_);
+            has_tasks_.wait(lock, [this] { return is_stopping_ || !tasks_.empty(); });
+            if (tasks_.empty()) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
+
+// ------------------ Serve ------------------
+
+static bool HasNextDocument(std::istream& input) {
+    input >> std::ws;
+    return input.peek() != std::char_traits<char>::eof();
+}
+
+bool Serve(std::istream& input, std::ostream& output) {
+
+    if (!HasNextDocument(input)) {
+        return false;
+    }
+    const auto settings = json::Load(input);
+    const auto& default_file = settings.GetRoot().AsDict()
+            .at("serialization_settings"s).AsDict().at("file"s).AsString();
+
+    std::shared_ptr<CatalogueSnapshot> snapshot;
+    try {
+        snapshot = LoadSnapshot(default_file, 1);
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return false;
+    }
+
+    SnapshotHolder holder(snapshot);
+
+    auto make_reader = [](CatalogueSnapshot& snapshot) {
+        auto reader = std::make_unique<JsonReader>(&snapshot.catalogue);
+        reader->SetRenderSettings(renderer::Settings(snapshot.render_settings));
+        return reader;
+    };
+    auto reader = make_reader(*snapshot);
+
+    while (HasNextDocument(input)) {
+        const auto document = json::Load(input);
+        const auto& request = document.GetRoot().AsDict();
+
+        // A reload switches between requests, never in the middle of one
+        if (auto current = holder.Get(); current != snapshot) {
+            reader = make_reader(*current);
+            holder.Retire(std::move(snapshot));
+            snapshot = std::move(current);
+        }
+
+        // The failure of a background load is reported by the next Reload and by ReloadStatus
+        auto add_last_error = [](json::Builder& response, const ReloadStatus& status) {
+            if (status.failed_version != 0) {
+                response.Key("last_reload_error"s).StartDict()
+                        .Key("version"s).Value(static_cast<int>(status.failed_version))
+                        .Key("error_message"s).Value(status.error)
+                        .EndDict();
+            }
+        };
+
+        if (request.at("type"s).AsString() == "Reload"s) {
+            const auto file = request.count("file"s) != 0 ? request.at("file"s).AsString() : default_file;
+            const auto status = holder.GetReloadStatus();
+            const auto version = holder.ReloadAsync(file);
+
+            json::Builder response;
+            response.StartDict().Key("request_id"s).Value(json::Node(request.at("id"s)).GetValue());
+            if (version == 0) {
+                response.Key("error_message"s).Value("reload in progress"s);
+            } else {
+                response.Key("version"s).Value(static_cast<int>(version));
+                add_last_error(response, status);
+            }
+            response.EndDict();
+            json::Print(json::Document(response.Build()), output);
+        } else if (request.at("type"s).AsString() == "Update"s) {
+            // Readers may hold the snapshot, and a Reload would drop the changes anyway
+            json::Print(json::Document(json::Builder{}.StartDict()
+                    .Key("request_id"s).Value(json::Node(request.at("id"s)).GetValue())
+                    .Key("error_message"s).Value("updates are not supported by serve, use update_base and Reload"s)
+                    .EndDict().Build()), output);
+        } else if (request.at("type"s).AsString() == "ReloadStatus"s) {
+            const auto status = holder.GetReloadStatus();
+
+            json::Builder response;
+            response.StartDict().Key("request_id"s).Value(json::Node(request.at("id"s)).GetValue())
+                    .Key("version"s).Value(static_cast<int>(status.current_version))
+                    .Key("loading"s).Value(status.is_loading);
+            add_last_error(response, status);
+            response.EndDict();
+            json::Print(json::Document(response.Build()), output);
+        } else {
+            reader->ProcessRequest(request);
+            for (const auto& answer : reader->TakeResponses()) {
+                json::Print(json::Document(answer), output);
+            }
+        }
+        output << std::endl;
+    }
+
+    holder.Retire(std::move(snapshot));
+    return true;
+}
+
+} // end namespace serial_database
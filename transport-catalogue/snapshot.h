@@ -0,0 +1,91 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "map_renderer.h"
+#include "transport_catalogue.h"
+
+namespace serial_database {
+
+// Catalogue with its router and render settings loaded from one base file. It is prepared
+// completely before it is published (the all-pairs router of a small network and route
+// statistics included), so the first queries after a switch do not pay for lazy initialization.
+struct CatalogueSnapshot {
+    std::string file;
+    uint64_t version = 0;
+    transport_catalogue::TransportCatalogue catalogue;
+    renderer::Settings render_settings;
+};
+
+// throws std::runtime_error if the file can not be read
+std::shared_ptr<CatalogueSnapshot> LoadSnapshot(const std::string& file, uint64_t version);
+
+struct ReloadStatus {
+    // Version of the snapshot being served
+    uint64_t current_version = 0;
+    bool is_loading = false;
+    // Version and error of the last finished load if it failed, 0 and empty if it succeeded
+    uint64_t failed_version = 0;
+    std::string error;
+};
+
+// Publishes the current snapshot to the readers. A new one is loaded on a background thread
+// and swapped in atomically, readers keep the snapshot they hold until they ask again.
+// Snapshots which are not used any more are destroyed on the background thread as well,
+// so neither loading nor freeing a base stalls the queries.
+class SnapshotHolder {
+public:
+    explicit SnapshotHolder(std::shared_ptr<CatalogueSnapshot> initial);
+
+    SnapshotHolder(const SnapshotHolder&) = delete;
+    SnapshotHolder& operator=(const SnapshotHolder&) = delete;
+
+    // Waits for the background work to finish
+    ~SnapshotHolder();
+
+    std::shared_ptr<CatalogueSnapshot> Get() const;
+
+    // Starts loading the file, returns the version the snapshot will get
+    // or 0 if another load is still running. The outcome is told by GetReloadStatus
+    uint64_t ReloadAsync(std::string file);
+
+    ReloadStatus GetReloadStatus() const;
+
+    // Takes the last reference of a snapshot the caller has switched away from
+    void Retire(std::shared_ptr<CatalogueSnapshot> snapshot);
+
+private:
+    // Accessed only through std::atomic_load / std::atomic_store
+    std::shared_ptr<CatalogueSnapshot> current_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable has_tasks_;
+    std::deque<std::function<void()>> tasks_;
+    bool is_loading_ = false;
+    bool is_stopping_ = false;
+    uint64_t last_version_;
+    uint64_t failed_version_ = 0;
+    std::string last_error_;
+    std::thread worker_;
+
+    void AddTask(std::function<void()> task);
+    void RunTasks();
+};
+
+// Long-running mode. The first JSON document on input holds serialization_settings, every next one
+// is a stat request answered with one JSON document on output. {"type": "Reload", "id", "file"} loads
+// a base (the same file by default) in the background and switches to it when it is ready, its answer
+// is not a confirmation. {"type": "ReloadStatus", "id"} tells the version served and the last failure.
+// Snapshots are never changed once published: Update requests are refused, the changes go through
+// update_base and a Reload of its output.
+bool Serve(std::istream& input, std::ostream& output);
+
+} // end namespace serial_database
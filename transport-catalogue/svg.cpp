@@ -71,6 +71,14 @@ Circle& Circle::SetRadius(double radius)  {
     return *this;
 }
 
+Point Circle::GetCenter() const {
+    return center_;
+}
+
+double Circle::GetRadius() const {
+    return radius_;
+}
+
 void Circle::RenderObject(const RenderContext& context) const {
     auto& out = context.out;
     out << "<circle cx=\""sv << center_.x << "\" cy=\""sv << center_.y << "\" "sv;
@@ -87,6 +95,10 @@ Polyline& Polyline::AddPoint(Point point) {
     return *this;
 }
 
+const std::deque<Point>& Polyline::GetPoints() const {
+    return points_;
+}
+
 void Polyline::RenderObject(const RenderContext& context) const {
     auto& out = context.out;
     out << "<polyline points=\""sv;
@@ -142,6 +154,26 @@ Text& Text::SetData(std::string data) {
     return *this;
 }
 
+Point Text::GetPosition() const {
+    return pos_;
+}
+
+Point Text::GetOffset() const {
+    return offset_;
+}
+
+uint32_t Text::GetFontSize() const {
+    return font_size_;
+}
+
+const std::string& Text::GetFontWeight() const {
+    return font_weight_;
+}
+
+const std::string& Text::GetData() const {
+    return data_;
+}
+
     // Прочие данные и методы, необходимые для реализации элемента <text>
 void Text::RenderObject(const RenderContext& context) const {
 
@@ -221,14 +253,33 @@ void Document::AddPtr(std::unique_ptr<Object>&& obj) {
 
     // Выводит в ostream svg-представление документа
 void Document::Render(std::ostream& out) const {
-    out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"sv << std::endl <<
-    "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">"sv << std::endl;
+    RenderHeader(out);
+    RenderObjects(out);
+    RenderFooter(out);
+}
+
+void Document::RenderObjects(std::ostream& out) const {
     for (const auto& i : objects_) {
         out << "  "sv;
         i->Render(RenderContext(out));
     }
+}
+
+void Document::RenderHeader(std::ostream& out) {
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"sv << std::endl <<
+    "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">"sv << std::endl;
+}
+
+void Document::RenderFooter(std::ostream& out) {
     out << "</svg>"sv;
 }
+
+void Document::Append(Document&& other) {
+    for (auto& i : other.objects_) {
+        objects_.push_back(std::move(i));
+    }
+    other.objects_.clear();
+}
     
 }  // namespace svg
 
@@ -129,6 +129,16 @@ public:
         return AsOwner();
     }
 
+    const std::optional<Color>& GetFillColor() const {
+        return fill_color_;
+    }
+    const std::optional<Color>& GetStrokeColor() const {
+        return stroke_color_;
+    }
+    const std::optional<double>& GetStrokeWidth() const {
+        return stroke_width_;
+    }
+
 protected:
     ~PathProps() = default;
 
@@ -265,6 +275,9 @@ public:
     Circle& SetCenter(Point center);
     Circle& SetRadius(double radius);
 
+    Point GetCenter() const;
+    double GetRadius() const;
+
 private:
     void RenderObject(const RenderContext& context) const override;
 
@@ -281,6 +294,8 @@ public:
     // Добавляет очередную вершину к ломаной линии
     Polyline& AddPoint(Point point);
 
+    const std::deque<Point>& GetPoints() const;
+
     /*
      * Прочие методы и данные, необходимые для реализации элемента <polyline>
      */
@@ -316,6 +331,12 @@ public:
     // Задаёт текстовое содержимое объекта (отображается внутри тега text)
     Text& SetData(std::string data);
 
+    Point GetPosition() const;
+    Point GetOffset() const;
+    uint32_t GetFontSize() const;
+    const std::string& GetFontWeight() const;
+    const std::string& GetData() const;
+
     // Прочие данные и методы, необходимые для реализации элемента <text>
 private:
     Point pos_ = Point(0, 0);
@@ -340,6 +361,15 @@ public:
     // Выводит в ostream svg-представление документа
     void Render(std::ostream& out) const;
 
+    // Выводит только теги объектов, без заголовка и закрывающего тега
+    void RenderObjects(std::ostream& out) const;
+
+    static void RenderHeader(std::ostream& out);
+    static void RenderFooter(std::ostream& out);
+
+    // Переносит в конец документа все объекты другого документа
+    void Append(Document&& other);
+
     // Прочие методы и данные, необходимые для реализации класса Document
     
 private:
@@ -1,7 +1,9 @@
 #include <cassert>
 #include <string_view>
 #include <algorithm>
+#include <cstdlib>
 #include <tuple>
+#include <stdexcept>
 #include <vector>
 
 #include "transport_catalogue.h"
@@ -26,6 +28,11 @@ void TransportCatalogue::AddStop(const std::string& name, Coordinates map_point)
     stop_name_to_stop_[std::string_view(stop_ptr->name)] = stop_ptr;
 
     stop_name_to_route_set_[stop_ptr];
+
+    if (router_ != nullptr) {
+        router_->AddVertex();
+    }
+    ++generation_;
 }
 
 void TransportCatalogue::SetDistance(const std::string& stop_name_from, const std::string& stop_name_to, int distance) {
@@ -34,11 +41,17 @@ void TransportCatalogue::SetDistance(const std::string& stop_name_from, const st
     assert(!stop_name_to.empty());
     assert(distance >= 0);
 
-    StopPtrPair  key = {stop_name_to_stop_[std::string_view(stop_name_from)],
-                stop_name_to_stop_[std::string_view(stop_name_to)]};
+    StopPtrPair key = {FindStop(stop_name_from), FindStop(stop_name_to)};
 
     all_distances_[key] = distance;
 
+    // Only routes which pass both stops can use the distance
+    for (Route* route_ptr : stop_name_to_route_set_[key.first]) {
+        if (stop_name_to_route_set_[key.second].count(route_ptr) != 0) {
+            MarkRouteChanged(route_ptr, true);
+        }
+    }
+    ++generation_;
 }
 
 void TransportCatalogue::AddRoute(const std::string &name, const std::vector <std::string> &stops, bool is_round) {
@@ -49,15 +62,17 @@ void TransportCatalogue::AddRoute(const std::string &name, const std::vector <st
 
     route.is_roundtrip = is_round;
 
+    // Stops are resolved before anything changes, an unknown one leaves the catalogue as it was
+    route.stops.reserve(stops.size());
+    for (const auto& i : stops) {
+        route.stops.push_back(FindStop(i));
+    }
+
     all_routes_.push_back(std::move(route));
     Route* route_ptr = &(all_routes_.back());
 
     route_name_to_route_[std::string_view(route_ptr->name)] = route_ptr;
 
-    for (const auto& i : stops) {
-        route_ptr->stops.push_back(stop_name_to_stop_.at(std::string_view(i)));
-    }
-
     for (const auto& i : route_ptr->stops) {
         stop_name_to_route_set_[i].insert(route_ptr);
     }
@@ -65,6 +80,10 @@ void TransportCatalogue::AddRoute(const std::string &name, const std::vector <st
     all_route_parameters_.push_back(RouteAdditionalParameters(route_ptr));
     route_name_to_additional_parameters_[std::string_view(route_ptr->name)] = &all_route_parameters_.back();
 
+    if (router_ != nullptr) {
+        routes_to_sync_.insert(route_ptr);
+    }
+    ++generation_;
 }
 
 const transport_catalogue::StopSearchResponse TransportCatalogue::SearchStop(const std::string& stop_name) const {
@@ -139,43 +158,185 @@ const OptimalPathSearchResponse TransportCatalogue::SearchOptimalPath(const std:
     int id_1 = stop_name_to_stop_.at(from)->id;
     int id_2 = stop_name_to_stop_.at(to)->id;
 
+    // Hot pairs skip the router, the cache is dropped when the catalogue changes
+    const PathCache::Key key{id_1, id_2};
+    if (auto cached = path_cache_->Find(key, generation_)) {
+        return *cached;
+    }
+
+    SyncRouter();
+
     auto path = router_->BuildRoute(id_1,id_2);
 
-    if (!path.has_value()) {
-        return dummy;
-    }
+    auto response = std::make_shared<const OptimalPathSearchResponse>(
+            path.has_value() ? MakePathResponse(path.value().edges) : dummy);
+    path_cache_->Insert(key, generation_, response);
 
-    const auto& edges = path.value().edges;
+    return *response;
+}
 
-    std::vector<OptimalPathItem> items;
+const OptimalPathSearchResponse TransportCatalogue::SearchTimetablePath(const std::string& from, const std::string& to,
+                                                                       double departure_time) {
 
-    double total_time = 0.0;
+    auto from_it = stop_name_to_stop_.find(std::string_view(from));
+    auto to_it = stop_name_to_stop_.find(std::string_view(to));
+    if (from_it == stop_name_to_stop_.end() || to_it == stop_name_to_stop_.end()) {
+        return {{}, 0, false};
+    }
 
-    for (auto edge_id : edges) {
+    if (connection_scan_ == nullptr || connection_scan_generation_ != generation_) {
+        for (auto& route : all_routes_) {
+            if (!route.departures.empty()) {
+                CalculateRouteDistances(route);
+            }
+        }
+        connection_scan_ = std::make_unique<ConnectionScanRouter>(router_->GetSettings(), all_routes_,
+                                                                  all_stops_.size());
+        connection_scan_generation_ = generation_;
+    }
 
-        const auto& edge = router_->GetEdge(edge_id);
-        const PathInfo& info = router_->GetInfo(edge_id);
+    const auto journey = connection_scan_->FindJourney(graph::VertexId(from_it->second->id),
+                                                       graph::VertexId(to_it->second->id),
+                                                       departure_time);
+    if (!journey) {
+        return {{}, 0, false};
+    }
 
+    std::vector<OptimalPathItem> items;
+    double time = departure_time;
+    for (const auto& ride : journey->rides) {
         items.emplace_back(OptimalPathItem{
                 "Wait"sv,
-                info.from->name,
+                ride.route_ptr->stops[ride.from_index]->name,
                 0,
-                router_->GetBusWaitTme()
+                ride.departure - time
         });
-
         items.emplace_back(OptimalPathItem{
                 "Bus"sv,
-                info.route_ptr->name,
-                info.span,
-                edge.weight - router_->GetBusWaitTme()
+                ride.route_ptr->name,
+                ride.to_index - ride.from_index,
+                ride.arrival - ride.departure,
+                ride.route_ptr,
+                ride.from_index,
+                ride.to_index
         });
+        time = ride.arrival;
+    }
 
-        total_time += edge.weight;
+    return {std::move(items), journey->arrival - departure_time, true};
+}
+
+const AlternativePathsSearchResponse TransportCatalogue::SearchAlternativePaths(const std::string& from,
+                                                                                const std::string& to, int count) {
+
+    auto from_it = stop_name_to_stop_.find(std::string_view(from));
+    auto to_it = stop_name_to_stop_.find(std::string_view(to));
+    if (from_it == stop_name_to_stop_.end() || to_it == stop_name_to_stop_.end() || count <= 0) {
+        return {{}, false};
     }
 
-    return {std::move(items),
-            total_time,
-            true};
+    SyncRouter();
+
+    std::vector<OptimalPathSearchResponse> options;
+    for (const auto& path : router_->BuildAlternativeRoutes(graph::VertexId(from_it->second->id),
+                                                            graph::VertexId(to_it->second->id),
+                                                            static_cast<size_t>(count))) {
+        options.push_back(MakePathResponse(path.edges));
+    }
+
+    const bool is_found = !options.empty();
+    return {std::move(options), is_found};
+}
+
+const TravelTimesSearchResponse TransportCatalogue::SearchTravelTimes(const std::vector<std::string>& from,
+                                                                      const std::vector<std::string>& to) {
+
+    auto to_vertices = [this](const std::vector<std::string>& names) {
+        std::vector<graph::VertexId> vertices;
+        vertices.reserve(names.size());
+        for (const auto& name : names) {
+            auto it = stop_name_to_stop_.find(std::string_view(name));
+            if (it == stop_name_to_stop_.end()) {
+                return std::optional<std::vector<graph::VertexId>>();
+            }
+            vertices.push_back(graph::VertexId(it->second->id));
+        }
+        return std::optional(std::move(vertices));
+    };
+
+    const auto sources = to_vertices(from);
+    const auto targets = to_vertices(to);
+    if (!sources || !targets) {
+        return {{}, false};
+    }
+
+    SyncRouter();
+
+    return {router_->ComputeTravelTimes(*sources, *targets), true};
+}
+
+const ParetoPathSearchResponse TransportCatalogue::SearchParetoPaths(const std::string& from, const std::string& to,
+                                                                     int max_transfers) {
+
+    auto from_it = stop_name_to_stop_.find(std::string_view(from));
+    auto to_it = stop_name_to_stop_.find(std::string_view(to));
+    if (from_it == stop_name_to_stop_.end() || to_it == stop_name_to_stop_.end()) {
+        return {{}, false};
+    }
+
+    if (raptor_ == nullptr || raptor_generation_ != generation_) {
+        for (auto& route : all_routes_) {
+            CalculateRouteDistances(route);
+        }
+        raptor_ = std::make_unique<RaptorRouter>(router_->GetSettings(), all_routes_, all_stops_.size());
+        raptor_generation_ = generation_;
+    }
+
+    const auto journeys = raptor_->FindJourneys(graph::VertexId(from_it->second->id),
+                                                graph::VertexId(to_it->second->id),
+                                                max_transfers + 1);
+
+    std::vector<OptimalPathSearchResponse> options;
+    for (const auto& journey : journeys) {
+        std::vector<OptimalPathItem> items;
+        for (const auto& ride : journey.rides) {
+            items.emplace_back(OptimalPathItem{
+                    "Wait"sv,
+                    ride.route_ptr->stops[ride.from_index]->name,
+                    0,
+                    router_->GetBusWaitTme()
+            });
+            items.emplace_back(OptimalPathItem{
+                    "Bus"sv,
+                    ride.route_ptr->name,
+                    std::abs(ride.to_index - ride.from_index),
+                    ride.time - router_->GetBusWaitTme(),
+                    ride.route_ptr,
+                    ride.from_index,
+                    ride.to_index
+            });
+        }
+        options.push_back({std::move(items), journey.total_time, true});
+    }
+
+    const bool is_found = !options.empty();
+    return {std::move(options), is_found};
+}
+
+const ReachableStopsSearchResponse TransportCatalogue::SearchReachableStops(const std::string& from, double max_time) {
+
+    auto it = stop_name_to_stop_.find(std::string_view(from));
+    if (it == stop_name_to_stop_.end()) {
+        return {{}, false};
+    }
+
+    SyncRouter();
+
+    std::vector<std::pair<const Stop*, double>> stops;
+    for (const auto& [vertex, time] : router_->ComputeReachable(graph::VertexId(it->second->id), max_time)) {
+        stops.emplace_back(&all_stops_[vertex], time);
+    }
+    return {std::move(stops), true};
 }
 
 int TransportCatalogue::GetDistance(const std::string& stop_name_from, const std::string& stop_name_to) const {
@@ -197,12 +358,10 @@ int TransportCatalogue::CalculateTrueRouteLength(const std::string& name) {
     if (route_name_to_additional_parameters_.count(std::string_view(name)) != 0) {
         RouteAdditionalParameters& params_ref = *route_name_to_additional_parameters_.at(std::string_view(name));
 
-        for (auto i = 0 ; i < static_cast<int>(params_ref.route_ptr->stops.size() - 1) ; ++i) {
+        CalculateRouteDistances(*params_ref.route_ptr);
+        const auto& distances = params_ref.route_ptr->forward_distances;
+        params_ref.true_route_length = distances.empty() ? 0 : distances.back();
 
-            params_ref.true_route_length += GetDistance(params_ref.route_ptr->stops[i]->name,
-                                                        params_ref.route_ptr->stops[i + 1]->name);
-
-        }
         return params_ref.true_route_length;
     }
 
@@ -217,7 +376,9 @@ std::map<std::string, const Route*> TransportCatalogue::GetAllRoutesPtr() const
 
     std::map<std::string, const Route*> result;
     for (const auto& i : all_routes_) {
-        result[i.name] = const_cast<Route*>(&i);
+        if (removed_route_ids_.count(i.id) == 0) {
+            result[i.name] = const_cast<Route*>(&i);
+        }
     }
     return result;
 }
@@ -226,6 +387,29 @@ bool TransportCatalogue::IsStopExist(const std::string_view& name) const {
     return stop_name_to_stop_.count(name) != 0;
 }
 
+bool TransportCatalogue::IsRouteExist(const std::string_view& name) const {
+    return route_name_to_route_.count(name) != 0;
+}
+
+bool TransportCatalogue::IsDistanceExist(const std::string_view& stop_name_from, const std::string_view& stop_name_to) const {
+    auto from = stop_name_to_stop_.find(stop_name_from);
+    auto to = stop_name_to_stop_.find(stop_name_to);
+    return from != stop_name_to_stop_.end() && to != stop_name_to_stop_.end()
+           && all_distances_.count({from->second, to->second}) != 0;
+}
+
+bool TransportCatalogue::IsDistanceUsed(const std::string_view& stop_name_from, const std::string_view& stop_name_to) const {
+    auto from = stop_name_to_stop_.find(stop_name_from);
+    auto to = stop_name_to_stop_.find(stop_name_to);
+    if (from == stop_name_to_stop_.end() || to == stop_name_to_stop_.end()) {
+        return false;
+    }
+    const auto& to_routes = stop_name_to_route_set_.at(to->second);
+    const auto& from_routes = stop_name_to_route_set_.at(from->second);
+    return std::any_of(from_routes.begin(), from_routes.end(),
+                       [&to_routes](Route* route_ptr) { return to_routes.count(route_ptr) != 0; });
+}
+
 const Route* TransportCatalogue::GetRoutePtr(const std::string_view& route_name) const {
     return const_cast<Route*>(route_name_to_route_.at(route_name));
 }
@@ -241,8 +425,12 @@ bool TransportCatalogue::RouterExist() const {
 void TransportCatalogue::CreateRouter(RouterSettings settings) {
 
     if (router_ == nullptr) {
+        // A new router is built from the current routes
+        routes_to_sync_.clear();
+        for (auto& route : all_routes_) {
+            CalculateRouteDistances(route);
+        }
         router_ = std::make_unique<TransportRouter>(TransportRouter(std::move(settings),
-                                                                    all_distances_,
                                                                     all_routes_,
                                                                     all_stops_.size()));
     }
@@ -253,14 +441,274 @@ std::unique_ptr<TransportRouter>& TransportCatalogue::GetRouter() {
 }
 
 void TransportCatalogue::CreateRouterFromProto(RouterSettings&& settings, graph::DirectedWeightedGraph<double>&& graph,
-                               std::unordered_map<graph::EdgeId, transport_catalogue::PathInfo>&& all_info) {
+                               std::vector<transport_catalogue::PathInfo>&& all_info) {
     if (router_ == nullptr) {
         router_ = std::make_unique<TransportRouter>(TransportRouter(std::move(settings),
-                                                                    all_distances_,
                                                                     all_routes_,
                                                                     std::move(graph),
                                                                     std::move(all_info)));
     }
 }
 
+Stop* TransportCatalogue::FindStop(const std::string& name) const {
+    auto it = stop_name_to_stop_.find(std::string_view(name));
+    if (it == stop_name_to_stop_.end()) {
+        throw std::out_of_range("Unknown stop "s + name);
+    }
+    return it->second;
+}
+
+Route* TransportCatalogue::FindRoute(const std::string& name) const {
+    auto it = route_name_to_route_.find(std::string_view(name));
+    if (it == route_name_to_route_.end()) {
+        throw std::out_of_range("Unknown bus "s + name);
+    }
+    return it->second;
+}
+
+void TransportCatalogue::MarkRouteChanged(Route* route_ptr, bool affects_router) {
+
+    if (auto it = route_name_to_additional_parameters_.find(std::string_view(route_ptr->name));
+            it != route_name_to_additional_parameters_.end()) {
+        *it->second = RouteAdditionalParameters(route_ptr);
+    }
+    route_ptr->forward_distances.clear();
+    route_ptr->backward_distances.clear();
+
+    if (affects_router && router_ != nullptr) {
+        routes_to_sync_.insert(route_ptr);
+    }
+}
+
+void TransportCatalogue::CalculateRouteDistances(Route& route) const {
+
+    if (route.forward_distances.size() == route.stops.size()) {
+        return;
+    }
+
+    const auto& stops = route.stops;
+    route.forward_distances.assign(stops.size(), 0);
+    route.backward_distances.assign(stops.size(), 0);
+    for (size_t index = 1; index < stops.size(); ++index) {
+        route.forward_distances[index] = route.forward_distances[index - 1] + GetDistance(stops[index - 1], stops[index]);
+        route.backward_distances[index] = route.backward_distances[index - 1] + GetDistance(stops[index], stops[index - 1]);
+    }
+}
+
+OptimalPathSearchResponse TransportCatalogue::MakePathResponse(const std::vector<graph::EdgeId>& edges) const {
+
+    std::vector<OptimalPathItem> items;
+
+    double total_time = 0.0;
+
+    for (auto edge_id : edges) {
+
+        const auto& edge = router_->GetEdge(edge_id);
+        const PathInfo& info = router_->GetInfo(edge_id);
+
+        items.emplace_back(OptimalPathItem{
+                "Wait"sv,
+                info.from->name,
+                0,
+                router_->GetBusWaitTme()
+        });
+
+        items.emplace_back(OptimalPathItem{
+                "Bus"sv,
+                info.route_ptr->name,
+                info.span,
+                edge.weight - router_->GetBusWaitTme(),
+                info.route_ptr,
+                info.from_index,
+                info.to_index
+        });
+
+        total_time += edge.weight;
+    }
+
+    return {std::move(items),
+            total_time,
+            true};
+}
+
+int TransportCatalogue::GetDistance(Stop* from, Stop* to) const {
+    if (auto it = all_distances_.find({from, to}); it != all_distances_.end()) {
+        return it->second;
+    }
+    return all_distances_.at({to, from});
+}
+
+void TransportCatalogue::UpdateStop(const std::string& name, Coordinates map_point) {
+
+    Stop* stop_ptr = FindStop(name);
+    stop_ptr->map_point = map_point;
+
+    // Travel times use road distances, only the geographic lengths change
+    for (Route* route_ptr : stop_name_to_route_set_.at(stop_ptr)) {
+        MarkRouteChanged(route_ptr, false);
+    }
+    ++generation_;
+}
+
+void TransportCatalogue::RemoveStop(const std::string& name) {
+
+    Stop* stop_ptr = FindStop(name);
+
+    if (!stop_name_to_route_set_.at(stop_ptr).empty()) {
+        throw std::logic_error("Stop "s + name + " is used by buses"s);
+    }
+
+    for (auto it = all_distances_.begin(); it != all_distances_.end(); ) {
+        if (it->first.first == stop_ptr || it->first.second == stop_ptr) {
+            it = all_distances_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    stop_name_to_route_set_.erase(stop_ptr);
+    stop_name_to_stop_.erase(std::string_view(stop_ptr->name));
+    removed_stop_ids_.insert(stop_ptr->id);
+    ++generation_;
+}
+
+void TransportCatalogue::RemoveDistance(const std::string& stop_name_from, const std::string& stop_name_to) {
+
+    StopPtrPair key = {FindStop(stop_name_from), FindStop(stop_name_to)};
+
+    if (all_distances_.erase(key) == 0) {
+        throw std::out_of_range("Unknown distance from "s + stop_name_from + " to "s + stop_name_to);
+    }
+
+    for (Route* route_ptr : stop_name_to_route_set_.at(key.first)) {
+        if (stop_name_to_route_set_.at(key.second).count(route_ptr) != 0) {
+            MarkRouteChanged(route_ptr, true);
+        }
+    }
+    ++generation_;
+}
+
+void TransportCatalogue::SetTimetable(const std::string& route_name, std::vector<double> departures,
+                                      std::vector<double> run_times) {
+
+    Route* route_ptr = FindRoute(route_name);
+    CheckTimetable(route_name, route_ptr->is_roundtrip, route_ptr->stops.size(), departures, run_times);
+
+    std::sort(departures.begin(), departures.end());
+    route_ptr->departures = std::move(departures);
+    route_ptr->run_times = std::move(run_times);
+    ++generation_;
+}
+
+void TransportCatalogue::CheckTimetable(const std::string& route_name, bool is_round, size_t stop_count,
+                                        const std::vector<double>& departures, std::vector<double>& run_times) {
+
+    const size_t segments = stop_count == 0 ? 0 : stop_count - 1;
+
+    if (!is_round && !run_times.empty() && run_times.size() * 2 == segments) {
+        run_times.insert(run_times.end(), run_times.rbegin(), run_times.rend());
+    }
+    if (!run_times.empty() && run_times.size() != segments) {
+        throw std::invalid_argument("Run times of bus "s + route_name + " do not match its stops"s);
+    }
+    if (std::any_of(run_times.begin(), run_times.end(), [](double time) { return time <= 0.0; })) {
+        throw std::invalid_argument("Run times of bus "s + route_name + " should be positive"s);
+    }
+    if (std::any_of(departures.begin(), departures.end(), [](double time) { return time < 0.0; })) {
+        throw std::invalid_argument("Departures of bus "s + route_name + " should not be negative"s);
+    }
+}
+
+void TransportCatalogue::UpdateRoute(const std::string& name, const std::vector<std::string>& stops, bool is_round) {
+
+    Route* route_ptr = FindRoute(name);
+
+    std::vector<Stop*> new_stops;
+    new_stops.reserve(stops.size());
+    for (const auto& stop_name : stops) {
+        new_stops.push_back(FindStop(stop_name));
+    }
+
+    for (Stop* stop_ptr : route_ptr->stops) {
+        stop_name_to_route_set_.at(stop_ptr).erase(route_ptr);
+    }
+
+    route_ptr->stops = std::move(new_stops);
+    route_ptr->is_roundtrip = is_round;
+
+    // The departures stay, the times then follow from the distances
+    if (route_ptr->run_times.size() + 1 != route_ptr->stops.size()) {
+        route_ptr->run_times.clear();
+    }
+
+    for (Stop* stop_ptr : route_ptr->stops) {
+        stop_name_to_route_set_.at(stop_ptr).insert(route_ptr);
+    }
+
+    MarkRouteChanged(route_ptr, true);
+    ++generation_;
+}
+
+void TransportCatalogue::RemoveRoute(const std::string& name) {
+
+    Route* route_ptr = FindRoute(name);
+
+    for (Stop* stop_ptr : route_ptr->stops) {
+        stop_name_to_route_set_.at(stop_ptr).erase(route_ptr);
+    }
+
+    // The route stays in the deque without stops, so it gets no router edges
+    route_ptr->stops.clear();
+    route_ptr->departures.clear();
+    route_ptr->run_times.clear();
+    MarkRouteChanged(route_ptr, true);
+
+    route_name_to_additional_parameters_.erase(std::string_view(route_ptr->name));
+    route_name_to_route_.erase(std::string_view(route_ptr->name));
+    removed_route_ids_.insert(route_ptr->id);
+    ++generation_;
+}
+
+bool TransportCatalogue::IsStopRemoved(int stop_id) const {
+    return removed_stop_ids_.count(stop_id) != 0;
+}
+
+bool TransportCatalogue::IsRouteRemoved(int route_id) const {
+    return removed_route_ids_.count(route_id) != 0;
+}
+
+const Stop* TransportCatalogue::GetStopById(int stop_id) const {
+    if (stop_id < 0 || stop_id >= static_cast<int>(all_stops_.size()) || IsStopRemoved(stop_id)) {
+        return nullptr;
+    }
+    return &all_stops_[stop_id];
+}
+
+const Route* TransportCatalogue::GetRouteById(int route_id) const {
+    if (route_id < 0 || route_id >= static_cast<int>(all_routes_.size()) || IsRouteRemoved(route_id)) {
+        return nullptr;
+    }
+    return &all_routes_[route_id];
+}
+
+void TransportCatalogue::SyncRouter() {
+
+    if (routes_to_sync_.empty()) {
+        return;
+    }
+    if (router_ != nullptr) {
+        for (const Route* route_ptr : routes_to_sync_) {
+            CalculateRouteDistances(all_routes_[route_ptr->id]);
+            router_->RebuildRouteEdges(*route_ptr);
+        }
+    }
+    routes_to_sync_.clear();
+}
+
+void TransportCatalogue::CompactRouter() {
+    if (router_ != nullptr) {
+        router_->CompactGraph();
+    }
+}
+
 } // end of namespace: transport_catalogue
\ No newline at end of file
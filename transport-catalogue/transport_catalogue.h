@@ -14,6 +14,9 @@
 #include "domain.h"
 
 #include "transport_router.h"
+#include "raptor.h"
+#include "connection_scan.h"
+#include "path_cache.h"
 
 namespace transport_catalogue {
 
@@ -40,6 +43,11 @@ struct OptimalPathItem {
     std::string_view name;
     int span_count = 0;
     double time = 0.0;
+
+    // Only for "Bus" items: the ride covers route_ptr->stops from from_index to to_index
+    const Route* route_ptr = nullptr;
+    int from_index = 0;
+    int to_index = 0;
 };
 
 struct OptimalPathSearchResponse {
@@ -48,6 +56,30 @@ struct OptimalPathSearchResponse {
     bool is_found;
 };
 
+struct TravelTimesSearchResponse {
+    // times[i][j] is the time from the i-th source to the j-th target, nullopt if it is unreachable
+    std::vector<std::vector<std::optional<double>>> times;
+    bool is_found;
+};
+
+struct ReachableStopsSearchResponse {
+    // Stops with their travel times, the nearest first
+    std::vector<std::pair<const Stop*, double>> stops;
+    bool is_found;
+};
+
+struct AlternativePathsSearchResponse {
+    // The fastest path first, then the alternatives riding other sequences of routes
+    std::vector<OptimalPathSearchResponse> options;
+    bool is_found;
+};
+
+struct ParetoPathSearchResponse {
+    // The fewest rides first, every next option is faster and has more rides
+    std::vector<OptimalPathSearchResponse> options;
+    bool is_found;
+};
+
 class TransportCatalogue {
 
 public:
@@ -60,10 +92,29 @@ public:
 
     int GetDistance(const std::string& stop_name_from, const std::string& stop_name_to) const;
 
+    // Replaces the timetable of the bus, see Route::departures. Run times of a non-round bus may be
+    // given for the way there only, the way back takes the same times. Empty departures remove it.
+    // throws std::out_of_range for an unknown bus, std::invalid_argument if the run times
+    // do not fit its stops or are not positive or a departure is negative
+    void SetTimetable(const std::string& route_name, std::vector<double> departures, std::vector<double> run_times);
+
+    // The checks of SetTimetable for a bus with stop_count stops, so a batch of changes can be
+    // checked before it is applied. Mirrors the run times of the way there like SetTimetable does.
+    static void CheckTimetable(const std::string& route_name, bool is_round, size_t stop_count,
+                               const std::vector<double>& departures, std::vector<double>& run_times);
+
     std::map<std::string, const Route*> GetAllRoutesPtr() const;
 
     bool IsStopExist(const std::string_view& name) const;
 
+    bool IsRouteExist(const std::string_view& name) const;
+
+    // Only the distance in this direction, GetDistance() falls back to the opposite one
+    bool IsDistanceExist(const std::string_view& stop_name_from, const std::string_view& stop_name_to) const;
+
+    // Whether a bus passes both stops, only then the distance between them is in the router edges
+    bool IsDistanceUsed(const std::string_view& stop_name_from, const std::string_view& stop_name_to) const;
+
     const Route* GetRoutePtr(const std::string_view& route_name) const;
 
     const Stop* GetStopPtr(const std::string_view& stop_name) const;
@@ -76,6 +127,30 @@ public:
 
     [[nodiscard]] const OptimalPathSearchResponse SearchOptimalPath(const std::string& from, const std::string& to);
 
+    // Matrix of the best travel times, is_found is false if one of the stops is unknown
+    [[nodiscard]] const TravelTimesSearchResponse SearchTravelTimes(const std::vector<std::string>& from,
+                                                                    const std::vector<std::string>& to);
+
+    // Earliest arrival by the timetables leaving the stop not before departure_time (minutes after
+    // midnight). Wait items are the time until the bus departs, total_time is counted from departure_time.
+    [[nodiscard]] const OptimalPathSearchResponse SearchTimetablePath(const std::string& from, const std::string& to,
+                                                                     double departure_time);
+
+    // Up to count paths ridden on different sequences of routes, the fastest first
+    [[nodiscard]] const AlternativePathsSearchResponse SearchAlternativePaths(const std::string& from,
+                                                                             const std::string& to, int count);
+
+    // Journeys which are best in time or in the number of transfers, with at most max_transfers transfers
+    [[nodiscard]] const ParetoPathSearchResponse SearchParetoPaths(const std::string& from, const std::string& to,
+                                                                   int max_transfers);
+
+    // Stops reachable from the stop within max_time minutes, the stop itself included
+    [[nodiscard]] const ReachableStopsSearchResponse SearchReachableStops(const std::string& from, double max_time);
+
+    PathCacheStats GetPathCacheStats() const {
+        return path_cache_->GetStats();
+    }
+
     bool RouterExist() const;
     void CreateRouter(RouterSettings settings);
 
@@ -93,7 +168,43 @@ public:
     std::unique_ptr<TransportRouter>& GetRouter();
 
     void CreateRouterFromProto(RouterSettings&& settings, graph::DirectedWeightedGraph<double>&& graph,
-                               std::unordered_map<graph::EdgeId, transport_catalogue::PathInfo>&& all_info);
+                               std::vector<transport_catalogue::PathInfo>&& all_info);
+
+    // ----- Incremental updates -----
+    // Ids are stable: removed stops and routes stay as tombstones and ids are never reused,
+    // so the ids of the others and the router vertices stay valid. Router edges of the
+    // changed routes are replaced in one batch by SyncRouter(), which path search also
+    // calls before answering.
+
+    void UpdateStop(const std::string& name, Coordinates map_point);
+
+    // throws std::logic_error if a bus still stops there
+    void RemoveStop(const std::string& name);
+
+    void RemoveDistance(const std::string& stop_name_from, const std::string& stop_name_to);
+
+    void UpdateRoute(const std::string& name, const std::vector<std::string>& stops, bool is_round);
+
+    void RemoveRoute(const std::string& name);
+
+    bool IsStopRemoved(int stop_id) const;
+
+    bool IsRouteRemoved(int route_id) const;
+
+    // nullptr for unknown and removed ids
+    const Stop* GetStopById(int stop_id) const;
+    const Route* GetRouteById(int route_id) const;
+
+    // Changes with every edit, so derived data (map colors, cached answers) can detect staleness
+    uint64_t GetGeneration() const {
+        return generation_;
+    }
+
+    // Replaces the router edges of the routes changed since the previous call
+    void SyncRouter();
+
+    // Drops the router edges replaced by SyncRouter()
+    void CompactRouter();
 
 private:
 
@@ -113,6 +224,38 @@ private:
 
     std::unique_ptr<TransportRouter> router_ = nullptr;
 
+    // Answers of the optimal path requests for the current generation of the catalogue
+    static constexpr size_t PATH_CACHE_CAPACITY = 16384;
+    std::unique_ptr<PathCache> path_cache_ = std::make_unique<PathCache>(PATH_CACHE_CAPACITY);
+
+    // Built on the first Pareto search and rebuilt after the catalogue changes
+    std::unique_ptr<RaptorRouter> raptor_ = nullptr;
+    uint64_t raptor_generation_ = 0;
+
+    // Connections of the timetables, built on the first timetable search and after the catalogue changes
+    std::unique_ptr<ConnectionScanRouter> connection_scan_ = nullptr;
+    uint64_t connection_scan_generation_ = 0;
+
+    std::unordered_set<int> removed_stop_ids_;
+    std::unordered_set<int> removed_route_ids_;
+    std::unordered_set<const Route*> routes_to_sync_;
+    uint64_t generation_ = 0;
+
+    Stop* FindStop(const std::string& name) const;
+    Route* FindRoute(const std::string& name) const;
+
+    // Forgets the cached statistics and distances and schedules the router update
+    void MarkRouteChanged(Route* route_ptr, bool affects_router);
+
+    // Fills the accumulated distances of the route if they are not up to date
+    // throws std::out_of_range if a distance between neighbouring stops is unknown
+    void CalculateRouteDistances(Route& route) const;
+
+    int GetDistance(Stop* from, Stop* to) const;
+
+    // Wait and Bus items of the path of the router
+    OptimalPathSearchResponse MakePathResponse(const std::vector<graph::EdgeId>& edges) const;
+
 };
 
 } // end of namespace: transport_catalogue
\ No newline at end of file
@@ -1,66 +1,617 @@
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <limits>
+#include <numeric>
 #include <optional>
+#include <thread>
+#include <tuple>
 
 #include "domain.h"
 #include "transport_router.h"
+#include "profile.h"
 
 namespace transport_catalogue {
 
     std::optional<Router<double>::RouteInfo> TransportRouter::BuildRoute(int from, int to) {
+        if (graph_.GetVertexCount() > ALL_PAIRS_MAX_VERTICES) {
+            const auto* tree = FindSourceTree(VertexId(from));
+            if (tree == nullptr) {
+                UpdateGeoBound();
+                return BuildRouteAStar(VertexId(from), VertexId(to));
+            }
+            auto edges = tree->GetPathEdges(VertexId(to));
+            if (!edges) {
+                return std::nullopt;
+            }
+            return Router<double>::RouteInfo{tree->GetWeight(VertexId(to)), std::move(*edges)};
+        }
+
         if (router_ == nullptr) {
+            profile::ScopedTimer timer("router.build_all_pairs");
             router_ = std::make_unique<Router<double>>(Router<double>{graph_});
         }
 
         return router_->BuildRoute(VertexId(from), VertexId(to));
     }
 
-    void TransportRouter::AutoFillGraph(size_t vertex_count) {
+    std::vector<std::vector<std::optional<double>>> TransportRouter::ComputeTravelTimes(
+            const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const {
+
+        std::vector<std::vector<std::optional<double>>> times(sources.size());
+
+        // The calling thread searches with its own tree, the helper threads borrow the spare trees of the router
+        auto fill_rows = [&](ShortestPathTree<double>& tree, size_t first, size_t last) {
+            uint64_t settled = 0;
+            for (size_t row = first; row < last; ++row) {
+                tree.Build(sources[row], targets);
+                settled += tree.GetSettledCount();
+
+                times[row].reserve(targets.size());
+                for (const VertexId target : targets) {
+                    times[row].push_back(tree.IsSettled(target) ? std::optional<double>(tree.GetWeight(target))
+                                                                : std::nullopt);
+                }
+            }
+            profile::Count("router.settled_vertices", settled);
+        };
+
+        // Every thread gets several searches, small matrices are computed on the calling thread
+        // since starting the threads would take longer than the searches themselves
+        static const size_t MIN_SOURCES_PER_THREAD = 8;
+        const size_t thread_count = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(),
+                                                                         sources.size() / MIN_SOURCES_PER_THREAD));
+
+        std::vector<std::unique_ptr<ShortestPathTree<double>>> spare_trees;
+        for (size_t shard = 1; shard < thread_count; ++shard) {
+            spare_trees.push_back(TakeSpareTree());
+        }
+
+        std::vector<std::future<void>> shards;
+        for (size_t shard = 1; shard < thread_count; ++shard) {
+            shards.push_back(std::async(std::launch::async, fill_rows, std::ref(*spare_trees[shard - 1]),
+                                        sources.size() * shard / thread_count,
+                                        sources.size() * (shard + 1) / thread_count));
+        }
+        fill_rows(GetThreadTree(), 0, sources.size() / thread_count);
+        for (auto& shard : shards) {
+            shard.get();
+        }
+
+        for (auto& tree : spare_trees) {
+            ReturnSpareTree(std::move(tree));
+        }
+
+        return times;
+    }
+
+    std::vector<Router<double>::RouteInfo> TransportRouter::BuildAlternativeRoutes(VertexId from, VertexId to,
+                                                                                  size_t count) const {
+        // Every ride of a found path makes its route this much slower for the next searches
+        static const double ROUTE_PENALTY = 1.5;
+        // Alternatives slower than the fastest path by more than this factor are not offered
+        static const double MAX_STRETCH = 1.5;
+        // Searches per requested path, some of them repeat the paths found before
+        static const size_t ATTEMPTS_PER_PATH = 3;
+
+        std::vector<Router<double>::RouteInfo> paths;
+        std::vector<std::vector<const Route*>> ridden_routes;
+        std::unordered_map<const Route*, double> penalties;
+
+        auto& tree = GetThreadTree();
+        auto penalized_weight = [this, &penalties](EdgeId edge_id) {
+            const double weight = graph_.GetEdge(edge_id).weight;
+            auto it = penalties.find(edge_path_info_[edge_id].route_ptr);
+            return it == penalties.end() ? weight : weight * it->second;
+        };
+
+        // A penalty on the route of an edge may make one of the detached parallel edges faster, the search
+        // goes by the fastest of them and the path takes the first such one. The others are not slower
+        // than the edge in the graph, so the edges of the routes without penalties stay as they are
+        auto fastest_parallel = [&](EdgeId edge_id) {
+            const double weight = graph_.GetEdge(edge_id).weight;
+            auto penalty_it = penalties.find(edge_path_info_[edge_id].route_ptr);
+            if (penalty_it == penalties.end()) {
+                return std::pair{edge_id, weight};
+            }
+            auto it = parallel_edges_.find(edge_id);
+            if (it == parallel_edges_.end()) {
+                return std::pair{edge_id, weight * penalty_it->second};
+            }
+            std::pair fastest{edge_id, std::numeric_limits<double>::max()};
+            for (const EdgeId parallel_id : it->second) {
+                if (const double parallel_weight = penalized_weight(parallel_id); parallel_weight < fastest.second) {
+                    fastest = {parallel_id, parallel_weight};
+                }
+            }
+            return fastest;
+        };
+
+        for (size_t attempt = 0; attempt < count * ATTEMPTS_PER_PATH && paths.size() < count; ++attempt) {
+            tree.Build(from, {to}, std::numeric_limits<double>::max(), [&](EdgeId edge_id, const Edge<double>&) {
+                return fastest_parallel(edge_id).second;
+            });
+            profile::Count("router.settled_vertices", tree.GetSettledCount());
+
+            auto edges = tree.GetPathEdges(to);
+            if (!edges) {
+                break;
+            }
+            for (EdgeId& edge_id : *edges) {
+                edge_id = fastest_parallel(edge_id).first;
+            }
+
+            double time = 0.0;
+            std::vector<const Route*> routes;
+            for (const EdgeId edge_id : *edges) {
+                time += graph_.GetEdge(edge_id).weight;
+                routes.push_back(edge_path_info_[edge_id].route_ptr);
+            }
+
+            for (const Route* route_ptr : routes) {
+                auto [it, is_new] = penalties.emplace(route_ptr, ROUTE_PENALTY);
+                if (!is_new) {
+                    it->second *= ROUTE_PENALTY;
+                }
+            }
+
+            // A later search may find a path within the stretch again, penalties only grow the other routes
+            if (!paths.empty() && time > paths.front().weight * MAX_STRETCH) {
+                continue;
+            }
+            if (std::find(ridden_routes.begin(), ridden_routes.end(), routes) != ridden_routes.end()) {
+                continue;
+            }
+            ridden_routes.push_back(std::move(routes));
+            paths.push_back(Router<double>::RouteInfo{time, std::move(*edges)});
+        }
+
+        // Penalized searches find the alternatives in no particular order of their real times
+        if (!paths.empty()) {
+            std::stable_sort(paths.begin() + 1, paths.end(), [](const auto& lhs, const auto& rhs) {
+                return lhs.weight < rhs.weight;
+            });
+        }
+        return paths;
+    }
+
+    std::vector<std::pair<VertexId, double>> TransportRouter::ComputeReachable(VertexId source, double max_time) const {
+
+        auto& tree = GetThreadTree();
+        tree.Build(source, {}, max_time);
+        profile::Count("router.settled_vertices", tree.GetSettledCount());
+
+        std::vector<std::pair<VertexId, double>> reachable;
+        reachable.reserve(tree.GetSettledCount());
+        for (const VertexId vertex : tree.GetSettledVertices()) {
+            reachable.emplace_back(vertex, tree.GetWeight(vertex));
+        }
+        return reachable;
+    }
+
+    uint64_t TransportRouter::NextSearchOwnerId() {
+        static std::atomic<uint64_t> next_id{0};
+        return ++next_id;
+    }
+
+    ShortestPathTree<double>& TransportRouter::GetThreadTree() const {
+
+        struct ThreadSearch {
+            uint64_t owner_id = 0;
+            const void* graph = nullptr;
+            std::unique_ptr<ShortestPathTree<double>> tree;
+        };
+        thread_local ThreadSearch search;
+
+        // A moved router keeps its id, so the graph address is checked as well
+        if (search.owner_id != search_owner_id_ || search.graph != &graph_) {
+            search = ThreadSearch{search_owner_id_, &graph_, std::make_unique<ShortestPathTree<double>>(graph_)};
+        }
+        return *search.tree;
+    }
+
+    std::unique_ptr<ShortestPathTree<double>> TransportRouter::TakeSpareTree() const {
+        std::lock_guard guard(spare_trees_->mutex);
+        // A moved router keeps the pool, the trees of the old graph address are not used
+        if (spare_trees_->graph != &graph_) {
+            spare_trees_->trees.clear();
+            spare_trees_->graph = &graph_;
+        }
+        if (spare_trees_->trees.empty()) {
+            return std::make_unique<ShortestPathTree<double>>(graph_);
+        }
+        auto tree = std::move(spare_trees_->trees.back());
+        spare_trees_->trees.pop_back();
+        return tree;
+    }
+
+    void TransportRouter::ReturnSpareTree(std::unique_ptr<ShortestPathTree<double>> tree) const {
+        std::lock_guard guard(spare_trees_->mutex);
+        if (spare_trees_->graph == &graph_) {
+            spare_trees_->trees.push_back(std::move(tree));
+        }
+    }
+
+    const ShortestPathTree<double>* TransportRouter::FindSourceTree(VertexId source) const {
+
+        static const size_t TREES_PER_THREAD = 8;
+        static const size_t RECENT_SOURCES_PER_THREAD = 16;
+
+        struct SourceTree {
+            uint64_t owner_id = 0;
+            const void* graph = nullptr;
+            uint64_t graph_version = 0;
+            std::unique_ptr<ShortestPathTree<double>> tree;
+        };
+        // The most recently used tree first
+        thread_local std::vector<SourceTree> trees;
+
+        auto is_current = [this](const SourceTree& entry) {
+            return entry.owner_id == search_owner_id_ && entry.graph == &graph_;
+        };
+
+        auto it = std::find_if(trees.begin(), trees.end(), [&](const SourceTree& entry) {
+            return is_current(entry) && entry.graph_version == graph_version_ && entry.tree->GetSource() == source;
+        });
+
+        if (it != trees.end()) {
+            profile::Count("router.source_tree_hits");
+        } else {
+            // A tree is built from a source asked for the second time, the first query searches one path
+            struct RecentSource {
+                uint64_t owner_id = 0;
+                const void* graph = nullptr;
+                VertexId source = 0;
+            };
+            thread_local std::deque<RecentSource> recent_sources;
+
+            auto recent_it = std::find_if(recent_sources.begin(), recent_sources.end(), [&](const RecentSource& entry) {
+                return entry.owner_id == search_owner_id_ && entry.graph == &graph_ && entry.source == source;
+            });
+            if (recent_it == recent_sources.end()) {
+                if (recent_sources.size() == RECENT_SOURCES_PER_THREAD) {
+                    recent_sources.pop_front();
+                }
+                recent_sources.push_back(RecentSource{search_owner_id_, &graph_, source});
+                return nullptr;
+            }
+            recent_sources.erase(recent_it);
+
+            // The least recently used tree is built again, its arrays are kept if it belongs to this router
+            if (trees.size() < TREES_PER_THREAD) {
+                trees.emplace_back();
+            }
+            it = std::prev(trees.end());
+            if (!is_current(*it)) {
+                *it = SourceTree{search_owner_id_, &graph_, 0, std::make_unique<ShortestPathTree<double>>(graph_)};
+            }
+            it->graph_version = graph_version_;
+            it->tree->Build(source);
+            profile::Count("router.source_tree_builds");
+            profile::Count("router.settled_vertices", it->tree->GetSettledCount());
+        }
+
+        std::rotate(trees.begin(), it, std::next(it));
+        return trees.front().tree.get();
+    }
+
+    void TransportRouter::UpdateGeoBound() {
 
+        if (geo_bound_version_ == graph_version_ && !vertex_points_.empty()) {
+            return;
+        }
+
+        // Coefficient from km/h to meters/minute = 0.06;
+        static const double MULTIPLY_COEF = 0.06;
+
+        vertex_points_.assign(graph_.GetVertexCount(), Coordinates{});
         for (const auto& route : routes_) {
-            route.is_roundtrip ? AddRoundEdge(route) :
-            AddNonRoundEdge(route);
+            for (const Stop* stop : route.stops) {
+                vertex_points_[stop->id] = stop->map_point;
+            }
+        }
+
+        // The straight line at the bus velocity is the bound if no road is shorter than it,
+        // otherwise the bound is scaled down by the shortest road relative to its line
+        geo_time_scale_ = MULTIPLY_COEF / settings_.bus_velocity_;
+        for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            if (edge_path_info_[edge_id].route_ptr == nullptr || edge.from == edge.to) {
+                continue;
+            }
+            const double line = ComputeDistance(vertex_points_[edge.from], vertex_points_[edge.to]);
+            const double ride_time = edge.weight - settings_.bus_wait_time_;
+            if (line > 0.0 && geo_time_scale_ * line > ride_time) {
+                geo_time_scale_ = std::max(ride_time, 0.0) / line;
+            }
         }
 
+        geo_bound_version_ = graph_version_;
     }
 
-    double TransportRouter::GetDistance(Stop* stop_ptr_from, Stop* stop_ptr_to) const {
-        StopPtrPair ptr_pair(stop_ptr_from, stop_ptr_to);
-        StopPtrPair reverse_ptr_pair(stop_ptr_to, stop_ptr_from);
+    std::optional<Router<double>::RouteInfo> TransportRouter::BuildRouteAStar(VertexId from, VertexId to) const {
+
+        // Bounds of the current query, computed once per vertex
+        struct Bounds {
+            std::vector<double> values;
+            std::vector<uint32_t> stamps;
+            uint32_t stamp = 0;
+        };
+        thread_local Bounds bounds;
+
+        if (bounds.values.size() < graph_.GetVertexCount()) {
+            bounds.values.resize(graph_.GetVertexCount());
+            bounds.stamps.resize(graph_.GetVertexCount());
+        }
+        if (++bounds.stamp == 0) {
+            std::fill(bounds.stamps.begin(), bounds.stamps.end(), 0);
+            bounds.stamp = 1;
+        }
+
+        const bool has_landmarks = landmarks_version_ == graph_version_
+                                   && landmarks_.IsValid(graph_.GetVertexCount());
+
+        // Every path to the target has at least one wait, the rides are not faster than the straight line.
+        // Both this and the landmark bound are consistent, so is their maximum
+        auto bound = [&](VertexId vertex) {
+            if (bounds.stamps[vertex] != bounds.stamp) {
+                bounds.stamps[vertex] = bounds.stamp;
+                bounds.values[vertex] = vertex == to ? 0.0 : settings_.bus_wait_time_ + geo_time_scale_
+                        * ComputeDistance(vertex_points_[vertex], vertex_points_[to]);
+                if (has_landmarks) {
+                    bounds.values[vertex] = std::max(bounds.values[vertex], landmarks_.GetLowerBound(vertex, to));
+                }
+            }
+            return bounds.values[vertex];
+        };
+
+        // Dijkstra over the reduced weights settles the vertices closer to the target first
+        auto& tree = GetThreadTree();
+        tree.Build(from, {to}, std::numeric_limits<double>::max(), [&](EdgeId, const Edge<double>& edge) {
+            return std::max(edge.weight - bound(edge.from) + bound(edge.to), 0.0);
+        });
+        profile::Count("router.settled_vertices", tree.GetSettledCount());
+
+        auto edges = tree.GetPathEdges(to);
+        if (!edges) {
+            return std::nullopt;
+        }
+
+        double weight = 0.0;
+        for (const EdgeId edge_id : *edges) {
+            weight += graph_.GetEdge(edge_id).weight;
+        }
+        return Router<double>::RouteInfo{weight, std::move(*edges)};
+    }
+
+    void TransportRouter::AutoFillGraph() {
+
+        // Removed routes keep their place in the deque without stops
+        std::vector<const Route*> routes;
+        for (const auto& route : routes_) {
+            if (!route.stops.empty()) {
+                routes.push_back(&route);
+            }
+        }
+
+        // The edges of a route get consecutive ids starting at its offset
+        std::vector<size_t> offsets(routes.size() + 1, 0);
+        for (size_t index = 0; index < routes.size(); ++index) {
+            offsets[index + 1] = offsets[index] + CountRides(*routes[index]);
+        }
+        const size_t edge_count = offsets.back();
+
+        std::vector<Edge<double>> edges(edge_count);
+        edge_path_info_.assign(edge_count, PathInfo{});
+
+        auto fill_routes = [&](size_t first, size_t last) {
+            for (size_t index = first; index < last; ++index) {
+                auto edge_id = offsets[index];
+                ForEachRide(*routes[index], [&](auto from, auto to) {
+                    std::tie(edges[edge_id], edge_path_info_[edge_id]) = MakeRide(*routes[index], from, to);
+                    ++edge_id;
+                });
+            }
+        };
+
+        // Contiguous shards of routes with about the same number of edges, small graphs stay on this thread
+        static const size_t MIN_EDGES_PER_THREAD = 10000;
+        const size_t thread_count = std::max<size_t>(1, std::min<size_t>(
+                {std::thread::hardware_concurrency(), edge_count / MIN_EDGES_PER_THREAD, routes.size()}));
+
+        std::vector<std::future<void>> shards;
+        size_t first = 0;
+        for (size_t shard = 1; shard < thread_count; ++shard) {
+            const auto bound = edge_count * shard / thread_count;
+            const auto last = static_cast<size_t>(std::upper_bound(offsets.begin() + first, offsets.end() - 1, bound)
+                                                  - offsets.begin());
+            shards.push_back(std::async(std::launch::async, fill_routes, first, last));
+            first = last;
+        }
+        fill_routes(first, routes.size());
+        for (auto& shard : shards) {
+            shard.get();
+        }
+
+        graph_.SetEdges(std::move(edges));
+        PruneAllParallelEdges();
+
+        for (size_t index = 0; index < routes.size(); ++index) {
+            auto& route_edges = route_edges_[routes[index]];
+            route_edges.resize(offsets[index + 1] - offsets[index]);
+            std::iota(route_edges.begin(), route_edges.end(), offsets[index]);
+        }
+
+        profile::Count("router.graph_edges", graph_.GetEdgeCount());
 
-        return distances_.count(ptr_pair) ? distances_.at(ptr_pair) : distances_.at(reverse_ptr_pair);
     }
 
-    void TransportRouter::AddRoundEdge(const Route& route) {
+    void TransportRouter::AddRouteEdges(const Route& route) {
+        auto& route_edges = route_edges_[&route];
+        ForEachRide(route, [&](auto from, auto to) {
+            auto [edge, info] = MakeRide(route, from, to);
+            const auto edge_id = graph_.AddEdge(edge);
+            route_edges.push_back(edge_id);
+            edge_path_info_.resize(edge_id + 1);
+            edge_path_info_[edge_id] = info;
+        });
+    }
+
+    void TransportRouter::PruneParallelEdges(VertexId vertex, std::vector<graph::EdgeId> edges) {
+
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+        edges.erase(std::remove_if(edges.begin(), edges.end(), [this](EdgeId edge_id) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            return edge_path_info_[edge_id].route_ptr == nullptr || edge.from == edge.to;
+        }), edges.end());
 
-        for (auto from_it = route.stops.begin(); from_it != route.stops.end(); ++from_it) {
+        for (const EdgeId edge_id : edges) {
+            parallel_edges_.erase(edge_id);
+        }
 
-            for (auto to_it = from_it + 1; to_it != route.stops.end(); ++to_it) {
+        // The edges of every target next to each other, each group in ascending order
+        std::stable_sort(edges.begin(), edges.end(), [this](EdgeId lhs, EdgeId rhs) {
+            return graph_.GetEdge(lhs).to < graph_.GetEdge(rhs).to;
+        });
 
-                CalcAndAddEdge(route, from_it, to_it);
+        graph::DirectedWeightedGraph<double>::IncidenceList incidence_list;
+        std::vector<graph::EdgeId> dominated;
+        for (auto first = edges.begin(); first != edges.end(); ) {
+            auto last = std::find_if(first, edges.end(), [&](EdgeId edge_id) {
+                return graph_.GetEdge(edge_id).to != graph_.GetEdge(*first).to;
+            });
+            auto fastest = first;
+            for (auto it = first; it != last; ++it) {
+                if (graph_.GetEdge(*it).weight < graph_.GetEdge(*fastest).weight) {
+                    fastest = it;
+                }
+            }
+            incidence_list.push_back(*fastest);
+            if (last - first > 1) {
+                parallel_edges_[*fastest].assign(first, last);
+                std::copy_if(first, last, std::back_inserter(dominated), [&](EdgeId edge_id) {
+                    return edge_id != *fastest;
+                });
             }
+            first = last;
+        }
+
+        // Ascending ids as if the edges were added one by one
+        std::sort(incidence_list.begin(), incidence_list.end());
+        graph_.SetIncidentEdges(vertex, std::move(incidence_list));
+
+        if (dominated.empty()) {
+            dominated_edges_.erase(vertex);
+        } else {
+            dominated_edges_[vertex] = std::move(dominated);
         }
     }
 
-    void TransportRouter::AddNonRoundEdge(const Route& route) {
+    void TransportRouter::PruneAllParallelEdges() {
 
-        auto middle_it = route.stops.begin() + (route.stops.size() / 2) == route.stops.end() ? route.stops.end() :
-                         route.stops.begin() + (route.stops.size() / 2) + 1 ;
+        std::vector<std::vector<graph::EdgeId>> edges_by_vertex(graph_.GetVertexCount());
+        for (graph::EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+            if (edge_path_info_[edge_id].route_ptr != nullptr) {
+                edges_by_vertex[graph_.GetEdge(edge_id).from].push_back(edge_id);
+            }
+        }
 
+        parallel_edges_.clear();
+        dominated_edges_.clear();
+        for (VertexId vertex = 0; vertex < edges_by_vertex.size(); ++vertex) {
+            PruneParallelEdges(vertex, std::move(edges_by_vertex[vertex]));
+        }
 
-        for (auto from_it = route.stops.begin(); from_it != middle_it; ++from_it) {
-            for (auto to_it = route.stops.begin(); to_it != middle_it; ++to_it) {
-                CalcAndAddEdge(route, from_it, to_it);
+        size_t dominated_count = 0;
+        for (const auto& [vertex, dominated] : dominated_edges_) {
+            dominated_count += dominated.size();
+        }
+        profile::Count("router.dominated_edges", dominated_count);
+    }
+
+    void TransportRouter::SetLandmarks(LandmarkBounds<double>&& landmarks) {
+        landmarks_ = std::move(landmarks);
+        landmarks_version_ = graph_version_;
+    }
+
+    void TransportRouter::AddVertex() {
+        graph_.AddVertex();
+        router_.reset();
+        ++graph_version_;
+    }
+
+    void TransportRouter::RebuildRouteEdges(const Route& route) {
+
+        // The vertices the route rides from, their parallel edges are pruned again afterwards
+        std::vector<VertexId> vertices;
+
+        if (auto it = route_edges_.find(&route); it != route_edges_.end()) {
+            for (const auto edge_id : it->second) {
+                vertices.push_back(graph_.GetEdge(edge_id).from);
+                graph_.RemoveEdge(edge_id);
+                edge_path_info_[edge_id] = PathInfo{};
+                parallel_edges_.erase(edge_id);
             }
+            route_edges_.erase(it);
         }
 
-        for (auto from_it= middle_it - 1; from_it != route.stops.end(); ++from_it) {
-            for (auto to_it = middle_it; to_it != route.stops.end(); ++to_it) {
-                CalcAndAddEdge(route, from_it, to_it);
+        if (!route.stops.empty()) {
+            AddRouteEdges(route);
+            for (const auto edge_id : route_edges_[&route]) {
+                vertices.push_back(graph_.GetEdge(edge_id).from);
             }
         }
+
+        std::sort(vertices.begin(), vertices.end());
+        vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+        for (const VertexId vertex : vertices) {
+            auto edges = graph_.GetIncidenceListsRef()[vertex];
+            if (auto it = dominated_edges_.find(vertex); it != dominated_edges_.end()) {
+                edges.insert(edges.end(), it->second.begin(), it->second.end());
+            }
+            PruneParallelEdges(vertex, std::move(edges));
+        }
+
+        router_.reset();
+        ++graph_version_;
     }
 
-}
+    void TransportRouter::CompactGraph() {
+
+        // The detached parallel edges are attached for the renumbering and pruned again afterwards
+        for (const auto& [vertex, dominated] : dominated_edges_) {
+            auto incidence_list = graph_.GetIncidenceListsRef()[vertex];
+            incidence_list.insert(incidence_list.end(), dominated.begin(), dominated.end());
+            graph_.SetIncidentEdges(vertex, std::move(incidence_list));
+        }
 
+        const auto new_ids = graph_.Compact();
 
+        std::vector<PathInfo> path_info(graph_.GetEdgeCount());
+        for (graph::EdgeId edge_id = 0; edge_id < new_ids.size(); ++edge_id) {
+            if (new_ids[edge_id] != graph::DirectedWeightedGraph<double>::REMOVED_EDGE) {
+                path_info[new_ids[edge_id]] = edge_path_info_[edge_id];
+            }
+        }
+        edge_path_info_ = std::move(path_info);
 
+        // Rides back to the stop they start at, kept by the bases written before they were skipped, are dropped
+        for (auto& [route_ptr, edges] : route_edges_) {
+            for (auto& edge_id : edges) {
+                edge_id = new_ids[edge_id];
+            }
+            edges.erase(std::remove(edges.begin(), edges.end(), graph::DirectedWeightedGraph<double>::REMOVED_EDGE),
+                        edges.end());
+        }
+        PruneAllParallelEdges();
+
+        router_.reset();
+        ++graph_version_;
+    }
+
+}
@@ -1,10 +1,15 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 #include <deque>
+#include <utility>
+#include <vector>
 
 #include "graph.h"
 #include "router.h"
+#include "shortest_path_tree.h"
+#include "landmarks.h"
 #include "ranges.h"
 #include "domain.h"
 
@@ -14,10 +19,14 @@ namespace transport_catalogue {
     using namespace domain;
     using namespace graph;
 
+    // Ride of one edge, route_ptr is null for the edges removed by the updates
     struct PathInfo {
-        const Route* route_ptr;
-        const Stop* from;
-        int span;
+        const Route* route_ptr = nullptr;
+        const Stop* from = nullptr;
+        int span = 0;
+        // Positions in route_ptr->stops of the first and the last stop of the ride
+        int from_index = 0;
+        int to_index = 0;
     };
 
     struct RouterSettings {
@@ -28,98 +37,219 @@ namespace transport_catalogue {
 class TransportRouter {
 public:
 
-    using DistanceMap = std::unordered_map<StopPtrPair, int, StopPtrHash, StopPtrPairEqualKey>;
-
-    TransportRouter(RouterSettings&& settings, const DistanceMap& distances, const std::deque<Route>& routes, size_t vertex_count)
-        : settings_(std::move(settings)), distances_(distances), routes_(routes), graph_(vertex_count)
+    // The distances of the routes are to be filled, see Route::forward_distances
+    TransportRouter(RouterSettings&& settings, const std::deque<Route>& routes, size_t vertex_count)
+        : settings_(std::move(settings)), routes_(routes), graph_(vertex_count)
     {
-        AutoFillGraph(vertex_count);
+        AutoFillGraph();
     }
 
-    TransportRouter(RouterSettings&& settings, const DistanceMap& distances,
-                    const std::deque<Route>& routes, graph::DirectedWeightedGraph<double>&& graph,
-                    std::unordered_map<graph::EdgeId, transport_catalogue::PathInfo>&& all_info)
+    TransportRouter(RouterSettings&& settings, const std::deque<Route>& routes, graph::DirectedWeightedGraph<double>&& graph,
+                    std::vector<transport_catalogue::PathInfo>&& all_info)
             : settings_(settings),
-            distances_(distances),
             routes_(routes),
             graph_(std::move(graph)),
-            edge_id_to_path_info_(std::move(all_info))
+            edge_path_info_(std::move(all_info))
     {
+        for (graph::EdgeId edge_id = 0; edge_id < edge_path_info_.size(); ++edge_id) {
+            if (edge_path_info_[edge_id].route_ptr != nullptr) {
+                route_edges_[edge_path_info_[edge_id].route_ptr].push_back(edge_id);
+            }
+        }
+        PruneAllParallelEdges();
     }
 
+    // Graphs with more vertices than this answer BuildRoute from per-source shortest path trees,
+    // the all-pairs router would take too long to build and too much memory
+    static constexpr size_t ALL_PAIRS_MAX_VERTICES = 100;
+
+    // Landmarks make_base picks for the lower bounds of A*
+    static constexpr size_t LANDMARK_COUNT = 16;
+
     std::optional<Router<double>::RouteInfo> BuildRoute(int from, int to);
 
+    // Travel times from every source to every target, nullopt for the unreachable ones. One shortest
+    // path tree is grown per source instead of the all-pairs router, the sources are shared among threads.
+    std::vector<std::vector<std::optional<double>>> ComputeTravelTimes(const std::vector<VertexId>& sources,
+                                                                       const std::vector<VertexId>& targets) const;
+
+    // Up to count paths: the fastest one first, then the fastest ones found after the routes ridden by the
+    // previous paths are made slower, ordered by their real travel times. Paths riding the same sequence
+    // of routes as an earlier one and paths much slower than the fastest are skipped.
+    std::vector<Router<double>::RouteInfo> BuildAlternativeRoutes(VertexId from, VertexId to, size_t count) const;
+
+    // Vertices reachable from the source within max_time with their times, the nearest first
+    std::vector<std::pair<VertexId, double>> ComputeReachable(VertexId source, double max_time) const;
+
     Edge<double> GetEdge(int edge_id) const {
         return graph_.GetEdge(EdgeId(edge_id));
     }
 
     const PathInfo& GetInfo(int edge_id) const {
-        return edge_id_to_path_info_.at(edge_id);
+        return edge_path_info_.at(edge_id);
     }
 
     double GetBusWaitTme() const {
         return settings_.bus_wait_time_;
     }
 
+    const RouterSettings& GetSettings() const {
+        return settings_;
+    }
+
     const graph::DirectedWeightedGraph<double>& GetGraph() {
         return graph_;
     }
 
-    const std::unordered_map<graph::EdgeId, PathInfo>& GetAllPathInfo() {
-        return edge_id_to_path_info_;
+    // Indexed by EdgeId
+    const std::vector<PathInfo>& GetAllPathInfo() {
+        return edge_path_info_;
     }
 
-    void SetAllPathInfo(std::unordered_map<graph::EdgeId, PathInfo>&& all_info) {
-        edge_id_to_path_info_ = std::move(all_info);
+    void SetAllPathInfo(std::vector<PathInfo>&& all_info) {
+        edge_path_info_ = std::move(all_info);
     }
 
+    // Landmark distances for A*, computed by make_base. They are dropped by the next change of the graph
+    void SetLandmarks(LandmarkBounds<double>&& landmarks);
+
+    // ----- Incremental updates, the all-pairs router and the source trees are rebuilt on the next BuildRoute -----
+
+    // A vertex for a stop added after the graph was built
+    void AddVertex();
+
+    // Replaces the edges of the route with the ones for its current stops and distances,
+    // a route without stops (a removed one) just loses its edges
+    void RebuildRouteEdges(const Route& route);
+
+    // Drops the edges removed by the updates and renumbers the remaining ones, the parallel edges are kept
+    void CompactGraph();
+
 private:
     RouterSettings settings_;
-    const DistanceMap& distances_;
     const std::deque<Route>& routes_;
     graph::DirectedWeightedGraph<double> graph_;
 
     std::unique_ptr<graph::Router<double>> router_ = nullptr;
 
-    std::unordered_map<graph::EdgeId, PathInfo> edge_id_to_path_info_;
+    std::vector<PathInfo> edge_path_info_;
 
-    void AutoFillGraph(size_t vertex_count);
+    // Edges added for every route, the ones to replace when the route changes
+    std::unordered_map<const Route*, std::vector<graph::EdgeId>> route_edges_;
 
-    void AddRoundEdge(const Route& route);
+    // Only the fastest edge of every pair of vertices is in the incidence lists, the others are detached
+    // and kept here by their source vertex to take its place when the route of the fastest one changes
+    std::unordered_map<VertexId, std::vector<graph::EdgeId>> dominated_edges_;
+    // All the edges of a pair in ascending order by the fastest one, for the pairs with several edges
+    std::unordered_map<graph::EdgeId, std::vector<graph::EdgeId>> parallel_edges_;
 
-    void AddNonRoundEdge(const Route& route);
+    // Tells the routers apart for the search state the threads keep between the queries
+    uint64_t search_owner_id_ = NextSearchOwnerId();
 
-    auto AddEdge(int from, int to, double time) {
-        return graph_.AddEdge({VertexId(from), VertexId(to), time});
-    }
+    // Changed by every update of the graph, the source trees of an older version are not used
+    uint64_t graph_version_ = 0;
 
-    double GetDistance(Stop* stop_ptr_from, Stop* stop_ptr_to) const;
+    // Stop points by vertex and minutes per meter of the straight line, both give the lower bounds of A*.
+    // The scale is such that no ride is faster than its straight line at it
+    std::vector<Coordinates> vertex_points_;
+    double geo_time_scale_ = 0.0;
+    uint64_t geo_bound_version_ = 0;
 
-    void AddInfo(int edge_id, PathInfo info) {
-        edge_id_to_path_info_[EdgeId(edge_id)] = std::move(info);
-    }
+    // Used while the graph is of the version they were set for
+    LandmarkBounds<double> landmarks_;
+    uint64_t landmarks_version_ = 0;
 
-    template <typename It>
-    double CalculateRealDistance(It from, It to) const {
-        double result = 0.0;
+    // Trees lent to the helper threads of ComputeTravelTimes, so their arrays are allocated once
+    // per router and not by every request. Behind a pointer to keep the router movable
+    struct SpareTrees {
+        std::mutex mutex;
+        const void* graph = nullptr;
+        std::vector<std::unique_ptr<ShortestPathTree<double>>> trees;
+    };
+    std::unique_ptr<SpareTrees> spare_trees_ = std::make_unique<SpareTrees>();
+
+    static uint64_t NextSearchOwnerId();
 
-        if (std::distance(from, to) > 0) {
-            for (auto i = from; i != to; ++i) {
-                result += std::abs(GetDistance(*i, *(i + 1)));
+    // Shortest path tree of the calling thread for this router, its arrays are reused by every query
+    ShortestPathTree<double>& GetThreadTree() const;
+
+    std::unique_ptr<ShortestPathTree<double>> TakeSpareTree() const;
+    void ReturnSpareTree(std::unique_ptr<ShortestPathTree<double>> tree) const;
+
+    // Complete shortest path tree from the source. Every thread keeps the trees of the sources it has
+    // searched from most recently, so the next queries from the same source only walk the predecessors.
+    // A tree is built only for a source asked for recently, nullptr the first time.
+    const ShortestPathTree<double>* FindSourceTree(VertexId source) const;
+
+    // Recomputes the stop points of the vertices and geo_time_scale_ after the graph changes
+    void UpdateGeoBound();
+
+    // Search of one path (A*): Dijkstra over the weights reduced by the lower bounds of the time left
+    // to the target, geographic and by the landmarks, which settles far fewer vertices than the whole tree
+    std::optional<Router<double>::RouteInfo> BuildRouteAStar(VertexId from, VertexId to) const;
+
+    // Edges of the routes are generated by several threads, each one writes the edges of its routes
+    // to the ids reserved for them, so the graph is the same as the one built on one thread
+    void AutoFillGraph();
+
+    // Adds the edges of one route, used by the incremental updates
+    void AddRouteEdges(const Route& route);
+
+    // Leaves in the incidence list of the vertex only the fastest of the given edges to every target,
+    // the first one of equal weights as the searches would take. Removed edges are dropped
+    void PruneParallelEdges(VertexId vertex, std::vector<graph::EdgeId> edges);
+
+    // Prunes the edges of every vertex, the incidence lists are built again from all the edges of the routes
+    void PruneAllParallelEdges();
+
+    // Calls func(from, to) for every ride along the route, the order defines the edge ids.
+    // A non-round route stores the way there and back, a ride does not pass its turning stop.
+    // Rides back to the stop they start at are skipped, no path takes them.
+    template <typename Func>
+    static void ForEachRide(const Route& route, Func&& func) {
+
+        auto ride = [&func](auto from_it, auto to_it) {
+            if (*from_it != *to_it) {
+                func(from_it, to_it);
             }
-        } else {
-            for (auto i = from; i != to; --i) {
-                result += std::abs(GetDistance(*i, *(i - 1)));
+        };
+
+        if (route.is_roundtrip) {
+            for (auto from_it = route.stops.begin(); from_it != route.stops.end(); ++from_it) {
+                for (auto to_it = from_it + 1; to_it != route.stops.end(); ++to_it) {
+                    ride(from_it, to_it);
+                }
+            }
+            return;
+        }
+
+        auto middle_it = route.stops.begin() + (route.stops.size() / 2) == route.stops.end() ? route.stops.end() :
+                         route.stops.begin() + (route.stops.size() / 2) + 1 ;
+
+        for (auto from_it = route.stops.begin(); from_it != middle_it; ++from_it) {
+            for (auto to_it = route.stops.begin(); to_it != middle_it; ++to_it) {
+                ride(from_it, to_it);
             }
         }
 
-        return result;
+        for (auto from_it= middle_it - 1; from_it != route.stops.end(); ++from_it) {
+            for (auto to_it = middle_it; to_it != route.stops.end(); ++to_it) {
+                ride(from_it, to_it);
+            }
+        }
+    }
+
+    static size_t CountRides(const Route& route) {
+        size_t count = 0;
+        ForEachRide(route, [&count](auto, auto) { ++count; });
+        return count;
     }
 
     template <typename It>
-    void CalcAndAddEdge(const Route& route, It from, It to) {
+    std::pair<Edge<double>, PathInfo> MakeRide(const Route& route, It from, It to) const {
 
-        double real_dist = CalculateRealDistance(from, to);
+        double real_dist = route.GetRideDistance(std::distance(route.stops.begin(), from),
+                                                 std::distance(route.stops.begin(), to));
 
         // ((meters / 1000) / (velocity km/h)) * 60 minutes_in_hour) + wait_time_in_minutes ==>
         // Coefficient from km/h to meters/minute = 0.06;
@@ -129,15 +259,12 @@ private:
 
         int span = std::abs(std::distance(from, to));
 
-        auto edge_id = AddEdge((*from)->id,
-                               (*to)->id,
-                               time
-        );
-
-        AddInfo(edge_id, PathInfo{&route,
-                                  *from,
-                                  span}
-        );
+        return {Edge<double>{VertexId((*from)->id), VertexId((*to)->id), time},
+                PathInfo{&route,
+                         *from,
+                         span,
+                         static_cast<int>(std::distance(route.stops.begin(), from)),
+                         static_cast<int>(std::distance(route.stops.begin(), to))}};
     }
 };
 